@@ -366,6 +366,7 @@ void RequestManager::RegisterRequest(camera_metadata_t * new_request, int * afMo
     memset(&(newEntry->internal_shot), 0, sizeof(struct camera2_shot_ext));
     m_metadataConverter->ToInternalShot(new_request, &(newEntry->internal_shot));
     newEntry->output_stream_count = 0;
+    newEntry->requestTime = systemTime();
     if (newEntry->internal_shot.shot.ctl.request.outputStreams[0] & MASK_OUTPUT_SCP)
         newEntry->output_stream_count++;
 
@@ -815,6 +816,18 @@ nsecs_t  RequestManager::GetTimestamp(int index)
     return frameTime;
 }
 
+nsecs_t  RequestManager::GetRequestTimeByFrameCnt(int frameCnt)
+{
+    int index = FindEntryIndexByFrameCnt(frameCnt);
+    if (index == -1) {
+        ALOGE("ERR(%s): Cannot find entry for frameCnt(%d)", __FUNCTION__, frameCnt);
+        return 0;
+    }
+
+    Mutex::Autolock lock(m_requestMutex);
+    return entries[index].requestTime;
+}
+
 uint8_t  RequestManager::GetOutputStreamByFrameCnt(int frameCnt)
 {
     int index = FindEntryIndexByFrameCnt(frameCnt);
@@ -982,6 +995,7 @@ ExynosCameraHWInterface2::ExynosCameraHWInterface2(int cameraId, camera2_device_
 
     m_exynosPictureCSC = NULL;
     m_exynosVideoCSC = NULL;
+    memset(&m_exifTemplate, 0, sizeof(m_exifTemplate));
 
     if (!m_grallocHal) {
         ret = hw_get_module(GRALLOC_HARDWARE_MODULE_ID, (const hw_module_t **)&m_grallocHal);
@@ -996,6 +1010,7 @@ ExynosCameraHWInterface2::ExynosCameraHWInterface2(int cameraId, camera2_device_
 
 
     m_BayerManager = new BayerBufManager();
+    m_memoryPool = new CameraMemoryPool();
     m_mainThread    = new MainThread(this);
     m_requestManager = new RequestManager((SignalDrivenThread*)(m_mainThread.get()));
     *openInvalid = InitializeISPChain();
@@ -1186,6 +1201,12 @@ void ExynosCameraHWInterface2::release()
     if (res != NO_ERROR ) {
         ALOGE("ERR(%s): exynos_v4l2_close failed(%d)",__FUNCTION__ , res);
     }
+    if (m_memoryPool != NULL) {
+        m_memoryPool->Dump();
+        delete m_memoryPool;
+        m_memoryPool = NULL;
+    }
+
     ALOGV("DEBUG(%s): calling deleteIonClient", __FUNCTION__);
     deleteIonClient(m_ionCameraClient);
 
@@ -1818,6 +1839,7 @@ int ExynosCameraHWInterface2::allocateStream(uint32_t width, uint32_t height, in
         }
         if (useDirectOutput) {
             *stream_id = STREAM_ID_ZSL;
+            m_BayerManager->SetZslMode(true);
 
             m_streamThreads[1]  = new StreamThread(this, *stream_id);
             AllocatedStream = (StreamThread*)(m_streamThreads[1].get());
@@ -1875,6 +1897,7 @@ int ExynosCameraHWInterface2::allocateStream(uint32_t width, uint32_t height, in
             ALOGD("END   stream thread 1 release %d", __LINE__);
 
             *stream_id = STREAM_ID_ZSL;
+            m_BayerManager->SetZslMode(true);
 
             m_streamThreadInitialize((SignalDrivenThread*)AllocatedStream);
 
@@ -2282,6 +2305,7 @@ int ExynosCameraHWInterface2::releaseStream(uint32_t stream_id)
             ALOGW("(%s): Stream Not Exists", __FUNCTION__);
             return NO_ERROR;
         }
+        m_BayerManager->SetZslMode(false);
 
         targetStream->m_numRegisteredStream--;
         ALOGV("(%s): m_numRegisteredStream = %d", __FUNCTION__, targetStream->m_numRegisteredStream);
@@ -2344,6 +2368,9 @@ int ExynosCameraHWInterface2::releaseStream(uint32_t stream_id)
             m_scpForceSuspended = true;
         }
         m_isIspStarted = false;
+        // no stream is left to reuse the idle buffers
+        if (m_memoryPool != NULL)
+            m_memoryPool->Trim(0);
     }
     ALOGV("(%s): END", __FUNCTION__);
     return 0;
@@ -2573,6 +2600,185 @@ bool ExynosCameraHWInterface2::m_getRatioSize(int  src_w,  int   src_h,
     return true;
 }
 
+CameraMemoryPool::CameraMemoryPool()
+{
+    ALOGV("DEBUG(%s): ", __FUNCTION__);
+    m_idleLimit = CAMERA_MEMPOOL_IDLE_LIMIT;
+    m_idleBytes = 0;
+    m_busyBytes = 0;
+    m_peakBytes = 0;
+    m_hitCount = 0;
+    m_missCount = 0;
+    m_trimCount = 0;
+}
+
+CameraMemoryPool::~CameraMemoryPool()
+{
+    ALOGV("%s", __FUNCTION__);
+    Trim(0);
+
+    Mutex::Autolock lock(m_poolLock);
+    // buffers still in use at this point are released for good
+    for (List<camera_mem_pool_entry_t>::iterator it = m_busyList.begin(); it != m_busyList.end(); it++) {
+        ALOGW("WARN(%s): fd(%d) size(%d) is still in use", __FUNCTION__, it->fd, it->size);
+        m_destroyEntry(&(*it));
+    }
+    m_busyList.clear();
+    m_busyBytes = 0;
+}
+
+int CameraMemoryPool::Alloc(ion_client ionClient, int size, int flag, int *fd, char **virt)
+{
+    camera_mem_pool_entry_t entry;
+    int allocSize = ALIGN(size, 4096);
+    int idleBytes;
+    bool hit;
+
+    *fd = -1;
+    *virt = (char *)MAP_FAILED;
+
+    {
+        Mutex::Autolock lock(m_poolLock);
+        hit = m_getIdleEntry(size, flag, &entry);
+        if (hit) {
+            m_hitCount++;
+            m_busyList.push_back(entry);
+            m_busyBytes += entry.size;
+        } else {
+            m_missCount++;
+        }
+        idleBytes = m_idleBytes;
+    }
+
+    if (hit) {
+        // ion_alloc() hands out cleared memory, keep that for small (metadata) planes
+        if (size <= CAMERA_MEMPOOL_CLEAR_LIMIT) {
+            memset(entry.virt, 0, size);
+            if (ion_sync(ionClient, entry.fd) < 0)
+                ALOGE("ERR(%s): ion_sync(%d) failed", __FUNCTION__, entry.fd);
+        }
+        *fd = entry.fd;
+        *virt = entry.virt;
+        return 0;
+    }
+
+    entry.size = allocSize;
+    entry.flag = flag;
+    entry.virt = (char *)MAP_FAILED;
+    entry.fd = ion_alloc(ionClient, allocSize, 0, ION_HEAP_SYSTEM_MASK, flag);
+    if ((entry.fd == -1) || (entry.fd == 0)) {
+        // give back what is kept idle and try once more
+        ALOGW("WARN(%s): ion_alloc(%d) failed, trimming %d idle bytes", __FUNCTION__, allocSize, idleBytes);
+        Trim(0);
+        entry.fd = ion_alloc(ionClient, allocSize, 0, ION_HEAP_SYSTEM_MASK, flag);
+        if ((entry.fd == -1) || (entry.fd == 0)) {
+            ALOGE("ERR(%s): ion_alloc(%d) failed", __FUNCTION__, allocSize);
+            return -1;
+        }
+    }
+
+    entry.virt = (char *)ion_map(entry.fd, allocSize, 0);
+    if ((entry.virt == (char *)MAP_FAILED) || (entry.virt == NULL)) {
+        ALOGE("ERR(%s): ion_map(%d) failed", __FUNCTION__, allocSize);
+        ion_free(entry.fd);
+        return -1;
+    }
+
+    {
+        Mutex::Autolock lock(m_poolLock);
+        m_busyList.push_back(entry);
+        m_busyBytes += entry.size;
+        if (m_peakBytes < m_busyBytes + m_idleBytes)
+            m_peakBytes = m_busyBytes + m_idleBytes;
+    }
+
+    *fd = entry.fd;
+    *virt = entry.virt;
+    return 0;
+}
+
+void CameraMemoryPool::Free(int fd, char *virt, int size)
+{
+    bool found = false;
+
+    {
+        Mutex::Autolock lock(m_poolLock);
+        for (List<camera_mem_pool_entry_t>::iterator it = m_busyList.begin(); it != m_busyList.end(); it++) {
+            if (it->fd == fd) {
+                m_busyBytes -= it->size;
+                m_idleBytes += it->size;
+                m_idleList.push_front(*it);
+                m_busyList.erase(it);
+                found = true;
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        // not allocated through the pool
+        ALOGW("WARN(%s): unknown fd(%d), releasing directly", __FUNCTION__, fd);
+        if (virt != (char *)MAP_FAILED)
+            ion_unmap(virt, size);
+        ion_free(fd);
+        return;
+    }
+
+    Trim(m_idleLimit);
+}
+
+void CameraMemoryPool::Trim(int maxIdleBytes)
+{
+    Mutex::Autolock lock(m_poolLock);
+
+    // least recently released entries are at the tail
+    while (m_idleBytes > maxIdleBytes && !m_idleList.empty()) {
+        List<camera_mem_pool_entry_t>::iterator it = --m_idleList.end();
+        m_idleBytes -= it->size;
+        m_destroyEntry(&(*it));
+        m_idleList.erase(it);
+        m_trimCount++;
+    }
+}
+
+void CameraMemoryPool::Dump(void)
+{
+    Mutex::Autolock lock(m_poolLock);
+    ALOGD("(%s): hit(%d) miss(%d) trim(%d) resident(%d) busy(%d) idle(%d) peak(%d)", __FUNCTION__,
+        m_hitCount, m_missCount, m_trimCount, m_busyBytes + m_idleBytes,
+        m_busyBytes, m_idleBytes, m_peakBytes);
+}
+
+bool CameraMemoryPool::m_getIdleEntry(int size, int flag, camera_mem_pool_entry_t *entry)
+{
+    List<camera_mem_pool_entry_t>::iterator best = m_idleList.end();
+
+    // best fit, wasting at most 1/8 of the request
+    for (List<camera_mem_pool_entry_t>::iterator it = m_idleList.begin(); it != m_idleList.end(); it++) {
+        if (it->flag != flag || it->size < size || it->size > size + (size >> 3))
+            continue;
+        if (best == m_idleList.end() || it->size < best->size)
+            best = it;
+    }
+
+    if (best == m_idleList.end())
+        return false;
+
+    *entry = *best;
+    m_idleBytes -= best->size;
+    m_idleList.erase(best);
+    return true;
+}
+
+void CameraMemoryPool::m_destroyEntry(camera_mem_pool_entry_t *entry)
+{
+    if (entry->virt != (char *)MAP_FAILED) {
+        if (ion_unmap(entry->virt, entry->size) < 0)
+            ALOGE("ERR(%s): ion_unmap failed", __FUNCTION__);
+    }
+    ion_free(entry->fd);
+}
+
 BayerBufManager::BayerBufManager()
 {
     ALOGV("DEBUG(%s): ", __FUNCTION__);
@@ -2588,6 +2794,17 @@ BayerBufManager::BayerBufManager()
     numOnIsp = 0;
     numOnHalFilled = 0;
     numOnHalEmpty = NUM_BAYER_BUFFERS;
+
+    zslEnable = false;
+    zslHead = 0;
+    for (int i = 0; i < NUM_ZSL_BAYER_FRAMES ; i++)
+        zslRing[i].bayerIndex = -1;
+    zslRecordCnt = 0;
+    zslOccupancySum = 0;
+    zslSelectCnt = 0;
+    zslMissCnt = 0;
+    zslDeltaSum = 0;
+    zslDeltaMax = 0;
 }
 
 BayerBufManager::~BayerBufManager()
@@ -2738,6 +2955,119 @@ int BayerBufManager::GetNumOnIsp()
     return numOnIsp;
 }
 
+void BayerBufManager::SetZslMode(bool enable)
+{
+    ALOGD("(%s): ZSL bayer ring %s", __FUNCTION__, enable ? "on" : "off");
+    if (!enable)
+        ZslDump();
+
+    Mutex::Autolock lock(zslLock);
+    zslEnable = enable;
+    zslHead = 0;
+    for (int i = 0; i < NUM_ZSL_BAYER_FRAMES ; i++)
+        zslRing[i].bayerIndex = -1;
+}
+
+bool BayerBufManager::IsZslMode()
+{
+    Mutex::Autolock lock(zslLock);
+    return zslEnable;
+}
+
+void BayerBufManager::ZslRecordFrame(int index, struct camera2_shot_ext *shot_ext)
+{
+    Mutex::Autolock lock(zslLock);
+    int occupancy = 0;
+
+    if (!zslEnable)
+        return;
+
+    // the oldest entry is overwritten, its buffer is back on the sensor by now
+    zsl_frame_entry_t *entry = &(zslRing[zslHead]);
+    entry->bayerIndex = index;
+    entry->frameCnt = shot_ext->shot.ctl.request.frameCount;
+    entry->timeStamp = shot_ext->shot.dm.sensor.timeStamp;
+    zslHead = (zslHead + 1) % NUM_ZSL_BAYER_FRAMES;
+
+    for (int i = 0; i < NUM_ZSL_BAYER_FRAMES ; i++) {
+        if (zslRing[i].bayerIndex != -1)
+            occupancy++;
+    }
+    zslRecordCnt++;
+    zslOccupancySum += occupancy;
+    ALOGV("DEBUG(%s): BayerIndex[%d] frameCnt(%d) ts(%lld) occupancy(%d)", __FUNCTION__,
+        index, entry->frameCnt, entry->timeStamp, occupancy);
+}
+
+void BayerBufManager::ZslReleaseFrame(int index)
+{
+    Mutex::Autolock lock(zslLock);
+
+    for (int i = 0; i < NUM_ZSL_BAYER_FRAMES ; i++) {
+        if (zslRing[i].bayerIndex == index)
+            zslRing[i].bayerIndex = -1;
+    }
+}
+
+int BayerBufManager::ZslSelectFrame(nsecs_t shutterTime, nsecs_t *timeStamp)
+{
+    Mutex::Autolock lock(zslLock);
+    int selected = -1, bayerIndex;
+    nsecs_t selectedDiff = 0, diff;
+
+    if (!zslEnable || shutterTime == 0)
+        return -1;
+
+    for (int i = 0; i < NUM_ZSL_BAYER_FRAMES ; i++) {
+        if (zslRing[i].bayerIndex == -1)
+            continue;
+        diff = zslRing[i].timeStamp - shutterTime;
+        if (diff < 0)
+            diff = -diff;
+        if (selected == -1 || diff < selectedDiff) {
+            selected = i;
+            selectedDiff = diff;
+        }
+    }
+
+    if (selected == -1) {
+        zslMissCnt++;
+        return -1;
+    }
+
+    zslSelectCnt++;
+    zslDeltaSum += selectedDiff;
+    if (selectedDiff > zslDeltaMax)
+        zslDeltaMax = selectedDiff;
+
+    ALOGV("DEBUG(%s): BayerIndex[%d] frameCnt(%d) delta(%lld)", __FUNCTION__,
+        zslRing[selected].bayerIndex, zslRing[selected].frameCnt, zslRing[selected].timeStamp - shutterTime);
+
+    // the frame goes through the ISP again for this capture, it cannot serve another one
+    *timeStamp = zslRing[selected].timeStamp;
+    bayerIndex = zslRing[selected].bayerIndex;
+    zslRing[selected].bayerIndex = -1;
+    return bayerIndex;
+}
+
+void BayerBufManager::ZslFlush()
+{
+    Mutex::Autolock lock(zslLock);
+    zslHead = 0;
+    for (int i = 0; i < NUM_ZSL_BAYER_FRAMES ; i++)
+        zslRing[i].bayerIndex = -1;
+}
+
+void BayerBufManager::ZslDump()
+{
+    Mutex::Autolock lock(zslLock);
+    ALOGD("(%s): records(%d) avg occupancy(%d/%d) selects(%d) misses(%d) shutter delta avg(%lld) max(%lld)",
+        __FUNCTION__, zslRecordCnt,
+        zslRecordCnt ? zslOccupancySum / zslRecordCnt : 0, NUM_ZSL_BAYER_FRAMES,
+        zslSelectCnt, zslMissCnt,
+        zslSelectCnt ? zslDeltaSum / zslSelectCnt : 0, zslDeltaMax);
+}
+
 int     BayerBufManager::GetNextIndex(int index)
 {
     index++;
@@ -2878,6 +3208,40 @@ void ExynosCameraHWInterface2::DumpInfoWithShot(struct camera2_shot_ext * shot_e
         shot_ext->shot.dm.request.frameCount );
 }
 
+int ExynosCameraHWInterface2::m_zslSwapCaptureFrame(int index, int frameCnt, nsecs_t *offset)
+{
+    struct camera2_shot_ext *shot_ext, *zsl_shot_ext;
+    struct camera2_dm zslDm;
+    nsecs_t sensorTime, requestTime, shutterTime, zslTime = 0;
+    int zslIndex;
+
+    shot_ext = (struct camera2_shot_ext *)(m_camera_info.sensor.buffer[index].virt.extP[1]);
+    sensorTime = shot_ext->shot.dm.sensor.timeStamp;
+    requestTime = m_requestManager->GetRequestTimeByFrameCnt(frameCnt);
+    if (sensorTime == 0 || requestTime == 0)
+        return index;
+
+    // the request time is taken on the system clock, move it onto the sensor
+    // clock using the frame just dequeued as the reference
+    shutterTime = sensorTime - (systemTime() - requestTime);
+
+    // pick the retained bayer closest to the moment the capture was requested
+    zslIndex = m_BayerManager->ZslSelectFrame(shutterTime, &zslTime);
+    if (zslIndex < 0 || zslIndex == index)
+        return index;
+
+    // the retained frame keeps its own sensor dm but takes the control of the current request
+    zsl_shot_ext = (struct camera2_shot_ext *)(m_camera_info.sensor.buffer[zslIndex].virt.extP[1]);
+    memcpy(&zslDm, &(zsl_shot_ext->shot.dm), sizeof(struct camera2_dm));
+    memcpy(zsl_shot_ext, shot_ext, sizeof(struct camera2_shot_ext));
+    memcpy(&(zsl_shot_ext->shot.dm), &zslDm, sizeof(struct camera2_dm));
+
+    *offset = zslTime - sensorTime;
+    ALOGD("(%s): frameCnt(%d) BayerIndex[%d] -> [%d] delta(%lld) offset(%lld)", __FUNCTION__,
+        frameCnt, index, zslIndex, zslTime - shutterTime, *offset);
+    return zslIndex;
+}
+
 void ExynosCameraHWInterface2::m_preCaptureSetter(struct camera2_shot_ext * shot_ext)
 {
     // Flash
@@ -3105,6 +3469,7 @@ void ExynosCameraHWInterface2::m_sensorThreadFunc(SignalDrivenThread * self)
         CAM_LOGD("(%s): ENTER processing SIGNAL_THREAD_RELEASE", __FUNCTION__);
 
         ALOGV("(%s): calling sensor streamoff", __FUNCTION__);
+        m_BayerManager->ZslFlush();
         cam_int_streamoff(&(m_camera_info.sensor));
         ALOGV("(%s): calling sensor streamoff done", __FUNCTION__);
 
@@ -3140,6 +3505,7 @@ void ExynosCameraHWInterface2::m_sensorThreadFunc(SignalDrivenThread * self)
         struct camera2_shot_ext *shot_ext;
         struct camera2_shot_ext *shot_ext_capture;
         bool triggered = false;
+        bool zslSwapped = false;
 
         /* dqbuf from sensor */
         ALOGV("Sensor DQbuf start");
@@ -3444,12 +3810,28 @@ void ExynosCameraHWInterface2::m_sensorThreadFunc(SignalDrivenThread * self)
                 CAM_LOGE("ERR(%s): dm.request.frameCount = %d", __FUNCTION__, shot_ext->shot.dm.request.frameCount);
             }
 
+            if (current_scc && m_BayerManager->IsZslMode()
+                && (shot_ext->shot.ctl.request.outputStreams[0] & STREAM_MASK_JPEG)
+                && m_nightCaptureCnt == 0 && (m_ctlInfo.flash.m_flashCnt < IS_FLASH_STATE_CAPTURE)) {
+                nsecs_t zslOffset = 0;
+                int zslIndex = m_zslSwapCaptureFrame(index, matchedFrameCnt, &zslOffset);
+                if (zslIndex != index) {
+                    // the ISP runs on the retained bayer, report its shutter time
+                    index = zslIndex;
+                    zslSwapped = true;
+                    frameTime += zslOffset;
+                    m_requestManager->RegisterTimestamp(matchedFrameCnt, &frameTime);
+                }
+            }
+
             cam_int_qbuf(&(m_camera_info.isp), index);
 
             ALOGV("### isp DQBUF start");
             index_isp = cam_int_dqbuf(&(m_camera_info.isp));
 
             shot_ext = (struct camera2_shot_ext *)(m_camera_info.isp.buffer[index_isp].virt.extP[1]);
+            if (!zslSwapped)
+                m_BayerManager->ZslRecordFrame(index_isp, shot_ext);
 
             if (m_ctlInfo.flash.m_flashEnableFlg)
                 m_preCaptureListenerISP(shot_ext);
@@ -3573,6 +3955,7 @@ void ExynosCameraHWInterface2::m_sensorThreadFunc(SignalDrivenThread * self)
             ALOGV("### isp DQBUF start (bubble)");
             index_isp = cam_int_dqbuf(&(m_camera_info.isp));
             shot_ext = (struct camera2_shot_ext *)(m_camera_info.isp.buffer[index_isp].virt.extP[1]);
+            m_BayerManager->ZslRecordFrame(index_isp, shot_ext);
             ALOGV("bubble: DM aa(%d) aemode(%d) awb(%d) afmode(%d)",
                 (int)(shot_ext->shot.dm.aa.mode), (int)(shot_ext->shot.dm.aa.aeMode),
                 (int)(shot_ext->shot.dm.aa.awbMode),
@@ -3595,6 +3978,7 @@ void ExynosCameraHWInterface2::m_sensorThreadFunc(SignalDrivenThread * self)
             shot_ext->request_scp = 0;
             shot_ext->request_sensor = 0;
         }
+        m_BayerManager->ZslReleaseFrame(index);
         cam_int_qbuf(&(m_camera_info.sensor), index);
         ALOGV("Sensor Qbuf done(%d)", index);
 
@@ -4747,6 +5131,11 @@ bool ExynosCameraHWInterface2::yuv2Jpeg(ExynosBuffer *yuvBuf,
     }
 
     m_setExifChangedAttribute(&mExifInfo, rect, &m_jpegMetadata);
+    jpegEnc.setExifTemplate(&m_exifTemplate);
+    if (jpegEnc.setExifMode(ExynosJpegEncoderForCamera::EXIF_MODE_DIRECT)) {
+        ALOGE("ERR(%s):jpegEnc.setExifMode() fail", __FUNCTION__);
+        goto jpeg_encode_done;
+    }
     ALOGV("DEBUG(%s):calling jpegEnc.setInBuf() yuvSize(%d)", __FUNCTION__, *yuvSize);
     if (jpegEnc.setInBuf((int *)&(yuvBuf->fd.fd), &(yuvBuf->virt.p), (int *)yuvSize)) {
         ALOGE("ERR(%s):jpegEnc.setInBuf() fail", __FUNCTION__);
@@ -6103,20 +6492,14 @@ int ExynosCameraHWInterface2::allocCameraMemory(ion_client ionClient, ExynosBuff
             flag = ION_FLAG_CACHED | ION_FLAG_CACHED_NEEDS_SYNC;
         else
             flag = 0;
-        buf->fd.extFd[i] = ion_alloc(ionClient, \
-                                      buf->size.extS[i], 0, ION_HEAP_SYSTEM_MASK, flag);
-        if ((buf->fd.extFd[i] == -1) ||(buf->fd.extFd[i] == 0)) {
-            ALOGE("[%s]ion_alloc(%d) failed\n", __FUNCTION__, buf->size.extS[i]);
-            buf->fd.extFd[i] = -1;
+        if (m_memoryPool == NULL) {
+            ALOGE("[%s] memory pool is released\n", __FUNCTION__);
             freeCameraMemory(buf, iMemoryNum);
             return -1;
         }
-
-        buf->virt.extP[i] = (char *)ion_map(buf->fd.extFd[i], \
-                                        buf->size.extS[i], 0);
-        if ((buf->virt.extP[i] == (char *)MAP_FAILED) || (buf->virt.extP[i] == NULL)) {
-            ALOGE("[%s]src ion map failed(%d)\n", __FUNCTION__, buf->size.extS[i]);
-            buf->virt.extP[i] = (char *)MAP_FAILED;
+        if (m_memoryPool->Alloc(ionClient, buf->size.extS[i], flag,
+                                &buf->fd.extFd[i], &buf->virt.extP[i]) < 0) {
+            ALOGE("[%s]alloc(%d) failed\n", __FUNCTION__, buf->size.extS[i]);
             freeCameraMemory(buf, iMemoryNum);
             return -1;
         }
@@ -6134,12 +6517,16 @@ void ExynosCameraHWInterface2::freeCameraMemory(ExynosBuffer *buf, int iMemoryNu
 
     for (i=0;i<iMemoryNum;i++) {
         if (buf->fd.extFd[i] != -1) {
-            if (buf->virt.extP[i] != (char *)MAP_FAILED) {
-                ret = ion_unmap(buf->virt.extP[i], buf->size.extS[i]);
-                if (ret < 0)
-                    ALOGE("ERR(%s)", __FUNCTION__);
+            if (m_memoryPool != NULL) {
+                m_memoryPool->Free(buf->fd.extFd[i], buf->virt.extP[i], buf->size.extS[i]);
+            } else {
+                if (buf->virt.extP[i] != (char *)MAP_FAILED) {
+                    ret = ion_unmap(buf->virt.extP[i], buf->size.extS[i]);
+                    if (ret < 0)
+                        ALOGE("ERR(%s)", __FUNCTION__);
+                }
+                ion_free(buf->fd.extFd[i]);
             }
-            ion_free(buf->fd.extFd[i]);
         ALOGV("freeCameraMemory : [%d][0x%08x] size(%d)", i, (unsigned int)(buf->virt.extP[i]), buf->size.extS[i]);
         }
         buf->fd.extFd[i] = -1;
@@ -68,6 +68,7 @@ namespace android {
 #define NUM_SCP_BUFFERS             (8)
 #define NUM_MIN_SENSOR_QBUF         (3)
 #define NUM_MAX_SUBSTREAM           (4)
+#define NUM_ZSL_BAYER_FRAMES        (NUM_BAYER_BUFFERS - NUM_MIN_SENSOR_QBUF)
 
 #define PICTURE_GSC_NODE_NUM (2)
 #define VIDEO_GSC_NODE_NUM (1)
@@ -120,6 +121,9 @@ namespace android {
 
 #define SIG_WAITING_TICK            (5000)
 
+#define CAMERA_MEMPOOL_IDLE_LIMIT   (64*1024*1024)
+#define CAMERA_MEMPOOL_CLEAR_LIMIT  (64*1024)
+
 #ifdef EXYNOS_CAMERA_LOG
 #define CAM_LOGV(...) ((void)ALOG(LOG_VERBOSE, LOG_TAG, __VA_ARGS__))
 #define CAM_LOGD(...) ((void)ALOG(LOG_DEBUG, LOG_TAG, __VA_ARGS__))
@@ -215,6 +219,7 @@ typedef struct request_manager_entry {
     camera_metadata_t           *original_request;
     struct camera2_shot_ext     internal_shot;
     int                         output_stream_count;
+    nsecs_t                     requestTime;
 } request_manager_entry_t;
 
 // structure related to a specific function of camera
@@ -279,6 +284,7 @@ public:
     void    RegisterTimestamp(int frameCnt, nsecs_t *frameTime);
     nsecs_t  GetTimestampByFrameCnt(int frameCnt);
     nsecs_t  GetTimestamp(int index);
+    nsecs_t  GetRequestTimeByFrameCnt(int frameCnt);
     uint8_t  GetOutputStreamByFrameCnt(int frameCnt);
     uint8_t  GetOutputStream(int index);
     camera2_shot_ext *  GetInternalShotExtByFrameCnt(int frameCnt);
@@ -336,6 +342,12 @@ typedef struct bayer_buf_entry {
     nsecs_t timeStamp;
 } bayer_buf_entry_t;
 
+typedef struct zsl_frame_entry {
+    int         bayerIndex;
+    int         frameCnt;
+    nsecs_t     timeStamp;      // sensor clock
+} zsl_frame_entry_t;
+
 
 class BayerBufManager {
 public:
@@ -352,6 +364,14 @@ public:
     int                 GetNumOnHalFilled();
     int                 GetNumOnIsp();
 
+    void                SetZslMode(bool enable);
+    bool                IsZslMode();
+    void                ZslRecordFrame(int index, struct camera2_shot_ext *shot_ext);
+    void                ZslReleaseFrame(int index);
+    int                 ZslSelectFrame(nsecs_t shutterTime, nsecs_t *timeStamp);
+    void                ZslFlush();
+    void                ZslDump();
+
 private:
     int                 GetNextIndex(int index);
 
@@ -365,6 +385,55 @@ private:
     int                 numOnHalEmpty;
 
     bayer_buf_entry_t   entries[NUM_BAYER_BUFFERS];
+
+    // bayer frames kept after ISP for zero shutter lag capture
+    Mutex               zslLock;
+    bool                zslEnable;
+    zsl_frame_entry_t   zslRing[NUM_ZSL_BAYER_FRAMES];
+    int                 zslHead;
+    int                 zslRecordCnt;
+    int                 zslOccupancySum;
+    int                 zslSelectCnt;
+    int                 zslMissCnt;
+    nsecs_t             zslDeltaSum;
+    nsecs_t             zslDeltaMax;
+};
+
+
+typedef struct camera_mem_pool_entry {
+    int     fd;
+    char    *virt;
+    int     size;
+    int     flag;
+} camera_mem_pool_entry_t;
+
+/*
+ * Keeps released ION allocations (still mapped) so that stream reconfiguration
+ * reuses them instead of going back to ion_alloc()/ion_map().
+ */
+class CameraMemoryPool {
+public:
+    CameraMemoryPool();
+    ~CameraMemoryPool();
+    int                 Alloc(ion_client ionClient, int size, int flag, int *fd, char **virt);
+    void                Free(int fd, char *virt, int size);
+    void                Trim(int maxIdleBytes);
+    void                Dump(void);
+
+private:
+    bool                m_getIdleEntry(int size, int flag, camera_mem_pool_entry_t *entry);
+    void                m_destroyEntry(camera_mem_pool_entry_t *entry);
+
+    Mutex                               m_poolLock;
+    List<camera_mem_pool_entry_t>       m_idleList;
+    List<camera_mem_pool_entry_t>       m_busyList;
+    int                 m_idleLimit;
+    int                 m_idleBytes;
+    int                 m_busyBytes;
+    int                 m_peakBytes;
+    int                 m_hitCount;
+    int                 m_missCount;
+    int                 m_trimCount;
 };
 
 
@@ -532,6 +601,7 @@ class MainThread : public SignalDrivenThread {
 
     RequestManager      *m_requestManager;
     BayerBufManager     *m_BayerManager;
+    CameraMemoryPool    *m_memoryPool;
     ExynosCamera2       *m_camera2;
 
     void                m_mainThreadFunc(SignalDrivenThread * self);
@@ -593,10 +663,12 @@ class MainThread : public SignalDrivenThread {
     void            SetAfStateForService(int newState);
     int             GetAfStateForService();
     exif_attribute_t    mExifInfo;
+    exif_template_t     m_exifTemplate;
     void            m_setExifFixedAttribute(void);
     void            m_setExifChangedAttribute(exif_attribute_t *exifInfo, ExynosRect *rect,
                          camera2_shot_ext *currentEntry);
     void            m_preCaptureSetter(struct camera2_shot_ext * shot_ext);
+    int             m_zslSwapCaptureFrame(int index, int frameCnt, nsecs_t *offset);
     void            m_preCaptureListenerSensor(struct camera2_shot_ext * shot_ext);
     void            m_preCaptureListenerISP(struct camera2_shot_ext * shot_ext);
     void            m_preCaptureAeState(struct camera2_shot_ext * shot_ext);
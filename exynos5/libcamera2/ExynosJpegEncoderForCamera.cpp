@@ -17,6 +17,7 @@
 
 #define LOG_TAG "ExynosJpegForCamera"
 #include <utils/Log.h>
+#include <stddef.h>
 
 #include "ExynosJpegEncoderForCamera.h"
 
@@ -34,6 +35,9 @@ static const char ExifAsciiPrefix[] = { 0x41, 0x53, 0x43, 0x49, 0x49, 0x0, 0x0,
 #define MAX_INPUT_BUFFER_PLANE_NUM (1)
 #define MAX_OUTPUT_BUFFER_PLANE_NUM (1)
 
+/* source offset and length of an exif_attribute_t member, for addExifPatch() */
+#define EXIF_ATTR(field) offsetof(exif_attribute_t, field), sizeof(((exif_attribute_t *)0)->field)
+
 ExynosJpegEncoderForCamera::ExynosJpegEncoderForCamera()
 {
     m_flagCreate = false;
@@ -43,6 +47,8 @@ ExynosJpegEncoderForCamera::ExynosJpegEncoderForCamera()
     m_thumbnailH = 0;
     m_thumbnailQuality = JPEG_THUMBNAIL_QUALITY;
     m_ionJpegClient = -1;
+    m_exifTemplate = NULL;
+    m_exifMode = EXIF_MODE_BUILD;
     initJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM);
     initJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM);
     initJpegMemory(&m_stMainInBuf, MAX_IMAGE_PLANE_NUM);
@@ -305,27 +311,60 @@ int ExynosJpegEncoderForCamera::encode(int *size, exif_attribute_t *exifInfo)
             exifInfo->enableThumb = false;
         }
 
-        exifOut = new unsigned char[bufSize];
-        if (exifOut == NULL) {
-            JPEG_ERROR_LOG("%s::Failed to allocate for exifOut\n", __func__);
-            delete[] exifOut;
-            return ERROR_EXIFOUT_ALLOC_FAIL;
-        }
-        memset(exifOut, 0, bufSize);
+        if ((m_exifMode == EXIF_MODE_DIRECT) && (m_exifTemplate != NULL)) {
+            char *thumbBuf = NULL;
+            unsigned int thumbSize = 0;
 
-        if (makeExif (exifOut, exifInfo, &exifLen)) {
-            JPEG_ERROR_LOG("%s::Failed to make EXIF\n", __func__);
-            delete[] exifOut;
-            return ERROR_MAKE_EXIF_FAIL;
-        }
+            if ((checkExifTemplate(exifInfo) == false) && compileExifTemplate(exifInfo)) {
+                JPEG_ERROR_LOG("%s::Failed to compile EXIF template\n", __func__);
+                return ERROR_MAKE_EXIF_FAIL;
+            }
 
-        if (exifLen <= EXIF_LIMIT_SIZE) {
-            memmove(pcJpegBuffer+exifLen+2, pcJpegBuffer+2, iJpegSize - 2);
-            memcpy(pcJpegBuffer+2, exifOut, exifLen);
-            iJpegSize += exifLen;
-        }
+            getThumbnailOutBuf(false, &thumbBuf, &thumbSize);
+            if ((exifInfo->enableThumb == false) || (thumbBuf == NULL))
+                thumbSize = 0;
+
+            exifLen = getExifTemplateSize(thumbSize);
+            if (exifLen <= EXIF_LIMIT_SIZE) {
+                if ((unsigned int)iJpegSize + exifLen > (unsigned int)iOutputSize) {
+                    JPEG_ERROR_LOG("%s::no room for EXIF(%d + %d > %d)\n", __func__, iJpegSize, exifLen, iOutputSize);
+                    return ERROR_OUT_BUFFER_SIZE_TOO_SMALL;
+                }
+                memmove(pcJpegBuffer+exifLen+2, pcJpegBuffer+2, iJpegSize - 2);
+                writeExifTemplate((unsigned char *)pcJpegBuffer+2, exifInfo, thumbBuf, thumbSize);
+#ifdef EXIF_TEMPLATE_VERIFY
+                verifyExifTemplate((unsigned char *)pcJpegBuffer+2, exifLen, exifInfo, false, thumbSize);
+#endif
+                iJpegSize += exifLen;
+            }
+        } else {
+            exifOut = new unsigned char[bufSize];
+            if (exifOut == NULL) {
+                JPEG_ERROR_LOG("%s::Failed to allocate for exifOut\n", __func__);
+                delete[] exifOut;
+                return ERROR_EXIFOUT_ALLOC_FAIL;
+            }
+            memset(exifOut, 0, bufSize);
+
+            if ((m_exifMode == EXIF_MODE_TEMPLATE) && (m_exifTemplate != NULL))
+                ret = makeExifFromTemplate(exifOut, exifInfo, &exifLen);
+            else
+                ret = makeExif(exifOut, exifInfo, &exifLen);
+
+            if (ret) {
+                JPEG_ERROR_LOG("%s::Failed to make EXIF\n", __func__);
+                delete[] exifOut;
+                return ERROR_MAKE_EXIF_FAIL;
+            }
 
-        delete[] exifOut;
+            if (exifLen <= EXIF_LIMIT_SIZE) {
+                memmove(pcJpegBuffer+exifLen+2, pcJpegBuffer+2, iJpegSize - 2);
+                memcpy(pcJpegBuffer+2, exifOut, exifLen);
+                iJpegSize += exifLen;
+            }
+
+            delete[] exifOut;
+        }
     }
 
     *size = iJpegSize;
@@ -511,31 +550,10 @@ int ExynosJpegEncoderForCamera::makeExif (unsigned char *exifOut,
     }
 
     //2 1th IFD TIFF Tags
-    int iThumbFd = 0;
     char *thumbBuf = NULL;
     unsigned int thumbSize = 0;
-    int thumbBufSize = 0;
-    int ret = ERROR_NONE;
 
-    if (useMainbufForThumb) {
-        if (m_jpegMain) {
-            ret = m_jpegMain->getOutBuf((int *)&iThumbFd, (int *)&thumbBufSize);
-            if (ret != ERROR_NONE) {
-                iThumbFd = -1;
-            }
-            thumbSize = (unsigned int)m_jpegMain->getJpegSize();
-            thumbBuf = m_stMainOutBuf.pcBuf[0];
-        }
-    } else {
-        if (m_jpegThumb) {
-            ret = m_jpegThumb->getOutBuf((int *)&iThumbFd, (int *)&thumbBufSize);
-            if (ret != ERROR_NONE) {
-                iThumbFd = -1;
-            }
-            thumbSize = (unsigned int)m_jpegThumb->getJpegSize();
-            thumbBuf = m_stThumbOutBuf.pcBuf[0];
-        }
-    }
+    getThumbnailOutBuf(useMainbufForThumb, &thumbBuf, &thumbSize);
 
     if (exifInfo->enableThumb && (thumbBuf != NULL) && (thumbSize != 0)) {
         exifSizeExceptThumb = tmp = LongerTagOffest;
@@ -596,9 +614,527 @@ int ExynosJpegEncoderForCamera::makeExif (unsigned char *exifOut,
     return ERROR_NONE;
 }
 
+int ExynosJpegEncoderForCamera::setExifTemplate(exif_template_t *exifTemplate)
+{
+    m_exifTemplate = exifTemplate;
+    return ERROR_NONE;
+}
+
+int ExynosJpegEncoderForCamera::setExifMode(int mode)
+{
+    if (mode < EXIF_MODE_BUILD || EXIF_MODE_DIRECT < mode) {
+        return ERROR_FAIL;
+    }
+
+    m_exifMode = mode;
+    return ERROR_NONE;
+}
+
+int ExynosJpegEncoderForCamera::makeExifFromTemplate(unsigned char *exifOut,
+                              exif_attribute_t *exifInfo,
+                              unsigned int *size,
+                              bool useMainbufForThumb)
+{
+    char *thumbBuf = NULL;
+    unsigned int thumbSize = 0;
+
+    if (m_exifTemplate == NULL) {
+        return ERROR_MAKE_EXIF_FAIL;
+    }
+
+    if ((checkExifTemplate(exifInfo) == false) && compileExifTemplate(exifInfo)) {
+        return ERROR_MAKE_EXIF_FAIL;
+    }
+
+    getThumbnailOutBuf(useMainbufForThumb, &thumbBuf, &thumbSize);
+    if ((exifInfo->enableThumb == false) || (thumbBuf == NULL))
+        thumbSize = 0;
+
+    writeExifTemplate(exifOut, exifInfo, thumbBuf, thumbSize);
+    *size = getExifTemplateSize(thumbSize);
+
+#ifdef EXIF_TEMPLATE_VERIFY
+    verifyExifTemplate(exifOut, *size, exifInfo, useMainbufForThumb, thumbSize);
+#endif
+
+    return ERROR_NONE;
+}
+
 /*
  * private member functions
 */
+void ExynosJpegEncoderForCamera::getThumbnailOutBuf(bool useMainbufForThumb,
+                                             char **thumbBuf,
+                                             unsigned int *thumbSize)
+{
+    int iThumbFd = 0;
+    int thumbBufSize = 0;
+    int ret = ERROR_NONE;
+
+    *thumbBuf = NULL;
+    *thumbSize = 0;
+
+    if (useMainbufForThumb) {
+        if (m_jpegMain) {
+            ret = m_jpegMain->getOutBuf((int *)&iThumbFd, (int *)&thumbBufSize);
+            if (ret != ERROR_NONE) {
+                iThumbFd = -1;
+            }
+            *thumbSize = (unsigned int)m_jpegMain->getJpegSize();
+            *thumbBuf = m_stMainOutBuf.pcBuf[0];
+        }
+    } else {
+        if (m_jpegThumb) {
+            ret = m_jpegThumb->getOutBuf((int *)&iThumbFd, (int *)&thumbBufSize);
+            if (ret != ERROR_NONE) {
+                iThumbFd = -1;
+            }
+            *thumbSize = (unsigned int)m_jpegThumb->getJpegSize();
+            *thumbBuf = m_stThumbOutBuf.pcBuf[0];
+        }
+    }
+}
+
+#ifdef EXIF_TEMPLATE_VERIFY
+/*
+ * Cross-check a templated segment, in the temporary buffer or already in the
+ * JPEG output buffer, byte for byte against makeExif().
+ */
+void ExynosJpegEncoderForCamera::verifyExifTemplate(unsigned char *exifOut,
+                                             unsigned int size,
+                                             exif_attribute_t *exifInfo,
+                                             bool useMainbufForThumb,
+                                             unsigned int thumbSize)
+{
+    /* makeExif() modifies user_comment, so build the reference from a copy */
+    exif_attribute_t exifRef;
+    unsigned int refSize = 0;
+    unsigned char *refOut = new unsigned char[EXIF_FILE_SIZE + thumbSize];
+
+    memcpy(&exifRef, exifInfo, sizeof(exifRef));
+    memset(refOut, 0, EXIF_FILE_SIZE + thumbSize);
+    makeExif(refOut, &exifRef, &refSize, useMainbufForThumb);
+    if ((refSize != size) || memcmp(refOut, exifOut, refSize))
+        JPEG_ERROR_LOG("ERR(%s):EXIF template mismatch(mode %d, size %d, ref %d)\n",
+                        __func__, m_exifMode, size, refSize);
+    delete[] refOut;
+}
+#endif
+
+bool ExynosJpegEncoderForCamera::checkExifTemplate(exif_attribute_t *exifInfo)
+{
+    exif_template_t *tpl = m_exifTemplate;
+
+    if (tpl->valid == false)
+        return false;
+
+    if (tpl->enableGps != exifInfo->enableGps)
+        return false;
+
+    if (strncmp((char *)tpl->maker, (char *)exifInfo->maker, sizeof(tpl->maker)) ||
+        strncmp((char *)tpl->model, (char *)exifInfo->model, sizeof(tpl->model)) ||
+        strncmp((char *)tpl->software, (char *)exifInfo->software, sizeof(tpl->software)) ||
+        strncmp((char *)tpl->user_comment, (char *)exifInfo->user_comment, sizeof(tpl->user_comment)))
+        return false;
+
+    if (exifInfo->enableGps &&
+        tpl->gpsMethodLen != strnlen((char *)exifInfo->gps_processing_method,
+                                     sizeof(exifInfo->gps_processing_method)))
+        return false;
+
+    tpl->hitCount++;
+    return true;
+}
+
+inline void ExynosJpegEncoderForCamera::addExifPatch(bool thumb,
+                                             unsigned char *pDst,
+                                             unsigned int src,
+                                             unsigned int len)
+{
+    exif_template_t *tpl = m_exifTemplate;
+    exif_template_patch_t *patch = thumb ? tpl->thumbPatch : tpl->patch;
+    int *num = thumb ? &tpl->numThumbPatch : &tpl->numPatch;
+    int max = thumb ? EXIF_TEMPLATE_MAX_THUMB_PATCH : EXIF_TEMPLATE_MAX_PATCH;
+
+    /* an overflow is caught by compileExifTemplate() */
+    if (*num < max) {
+        patch[*num].dst = (unsigned short)(pDst - tpl->seg);
+        patch[*num].src = (unsigned short)src;
+        patch[*num].len = (unsigned short)len;
+    }
+    (*num)++;
+}
+
+/*
+ * Same layout as makeExif(), but every value which may change per shot is recorded
+ * as a patch instead of being part of the template.
+ */
+int ExynosJpegEncoderForCamera::compileExifTemplate(exif_attribute_t *exifInfo)
+{
+    exif_template_t *tpl = m_exifTemplate;
+    unsigned char *pCur, *pIfdStart, *pGpsIfdPtr = NULL, *pNextIfdOffset;
+    unsigned int tmp, LongerTagOffest = 0, dataOffset, exifSizeExceptThumb;
+
+    tpl->valid = false;
+    tpl->numPatch = 0;
+    tpl->numThumbPatch = 0;
+    memset(tpl->seg, 0, sizeof(tpl->seg));
+
+    pCur = tpl->seg;
+
+    //2 Exif Identifier Code & TIFF Header
+    pCur += 4;  // APP1 marker and length are written per shot
+    unsigned char ExifIdentifierCode[6] = { 0x45, 0x78, 0x69, 0x66, 0x00, 0x00 };
+    memcpy(pCur, ExifIdentifierCode, 6);
+    pCur += 6;
+
+    /* Byte Order - little endian, Offset of IFD - 0x00000008.H */
+    unsigned char TiffHeader[8] = { 0x49, 0x49, 0x2A, 0x00, 0x08, 0x00, 0x00, 0x00 };
+    memcpy(pCur, TiffHeader, 8);
+    pIfdStart = pCur;
+    pCur += 8;
+
+    //2 0th IFD TIFF Tags
+    if (exifInfo->enableGps)
+        tmp = NUM_0TH_IFD_TIFF;
+    else
+        tmp = NUM_0TH_IFD_TIFF - 1;
+
+    memcpy(pCur, &tmp, NUM_SIZE);
+    pCur += NUM_SIZE;
+
+    LongerTagOffest += 8 + NUM_SIZE + tmp*IFD_SIZE + OFFSET_SIZE;
+
+    writeExifIfd(&pCur, EXIF_TAG_IMAGE_WIDTH, EXIF_TYPE_LONG,
+                 1, exifInfo->width);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(width));
+    writeExifIfd(&pCur, EXIF_TAG_IMAGE_HEIGHT, EXIF_TYPE_LONG,
+                 1, exifInfo->height);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(height));
+    writeExifIfd(&pCur, EXIF_TAG_MAKE, EXIF_TYPE_ASCII,
+                 strlen((char *)exifInfo->maker) + 1, exifInfo->maker, &LongerTagOffest, pIfdStart);
+    writeExifIfd(&pCur, EXIF_TAG_MODEL, EXIF_TYPE_ASCII,
+                 strlen((char *)exifInfo->model) + 1, exifInfo->model, &LongerTagOffest, pIfdStart);
+    writeExifIfd(&pCur, EXIF_TAG_ORIENTATION, EXIF_TYPE_SHORT,
+                 1, exifInfo->orientation);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(orientation));
+    writeExifIfd(&pCur, EXIF_TAG_SOFTWARE, EXIF_TYPE_ASCII,
+                 strlen((char *)exifInfo->software) + 1, exifInfo->software, &LongerTagOffest, pIfdStart);
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_DATE_TIME, EXIF_TYPE_ASCII,
+                 20, exifInfo->date_time, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(date_time));
+    writeExifIfd(&pCur, EXIF_TAG_SUBSEC_TIME, EXIF_TYPE_ASCII,
+                 sizeof(exifInfo->sub_sec), exifInfo->sub_sec);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(sub_sec));
+    writeExifIfd(&pCur, EXIF_TAG_YCBCR_POSITIONING, EXIF_TYPE_SHORT,
+                 1, exifInfo->ycbcr_positioning);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(ycbcr_positioning));
+    writeExifIfd(&pCur, EXIF_TAG_EXIF_IFD_POINTER, EXIF_TYPE_LONG,
+                 1, LongerTagOffest);
+    if (exifInfo->enableGps) {
+        pGpsIfdPtr = pCur;
+        pCur += IFD_SIZE;   // Skip a ifd size for gps IFD pointer
+    }
+
+    pNextIfdOffset = pCur;  // next IFD offset is written per shot
+    pCur += OFFSET_SIZE;
+
+    //2 0th IFD Exif Private Tags
+    pCur = pIfdStart + LongerTagOffest;
+
+    tmp = NUM_0TH_IFD_EXIF;
+    memcpy(pCur, &tmp , NUM_SIZE);
+    pCur += NUM_SIZE;
+
+    LongerTagOffest += NUM_SIZE + NUM_0TH_IFD_EXIF*IFD_SIZE + OFFSET_SIZE;
+
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_EXPOSURE_TIME, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->exposure_time, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(exposure_time));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_FNUMBER, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->fnumber, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(fnumber));
+    writeExifIfd(&pCur, EXIF_TAG_EXPOSURE_PROGRAM, EXIF_TYPE_SHORT,
+                 1, exifInfo->exposure_program);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(exposure_program));
+    writeExifIfd(&pCur, EXIF_TAG_ISO_SPEED_RATING, EXIF_TYPE_SHORT,
+                 1, exifInfo->iso_speed_rating);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(iso_speed_rating));
+    writeExifIfd(&pCur, EXIF_TAG_EXIF_VERSION, EXIF_TYPE_UNDEFINED,
+                 4, exifInfo->exif_version);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(exif_version));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_DATE_TIME_ORG, EXIF_TYPE_ASCII,
+                 20, exifInfo->date_time, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(date_time));
+    writeExifIfd(&pCur, EXIF_TAG_SUBSEC_TIME_ORG, EXIF_TYPE_ASCII,
+                 sizeof(exifInfo->sub_sec), exifInfo->sub_sec);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(sub_sec));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_DATE_TIME_DIGITIZE, EXIF_TYPE_ASCII,
+                 20, exifInfo->date_time, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(date_time));
+    writeExifIfd(&pCur, EXIF_TAG_SUBSEC_TIME_DIGITIZE, EXIF_TYPE_ASCII,
+                 sizeof(exifInfo->sub_sec), exifInfo->sub_sec);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(sub_sec));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_SHUTTER_SPEED, EXIF_TYPE_SRATIONAL,
+                 1, (rational_t *)&exifInfo->shutter_speed, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(shutter_speed));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_APERTURE, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->aperture, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(aperture));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_BRIGHTNESS, EXIF_TYPE_SRATIONAL,
+                 1, (rational_t *)&exifInfo->brightness, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(brightness));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_EXPOSURE_BIAS, EXIF_TYPE_SRATIONAL,
+                 1, (rational_t *)&exifInfo->exposure_bias, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(exposure_bias));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_MAX_APERTURE, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->max_aperture, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(max_aperture));
+    writeExifIfd(&pCur, EXIF_TAG_METERING_MODE, EXIF_TYPE_SHORT,
+                 1, exifInfo->metering_mode);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(metering_mode));
+    writeExifIfd(&pCur, EXIF_TAG_FLASH, EXIF_TYPE_SHORT,
+                 1, exifInfo->flash);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(flash));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_FOCAL_LENGTH, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->focal_length, &LongerTagOffest, pIfdStart);
+    addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(focal_length));
+    /* makeExif() prefixes user_comment in place, here it is done on a local copy */
+    char code[8] = { 0x00, 0x00, 0x00, 0x49, 0x49, 0x43, 0x53, 0x41 };
+    unsigned char comment[sizeof(code) + sizeof(exifInfo->user_comment)];
+    int commentsLen = strnlen((char *)exifInfo->user_comment, sizeof(exifInfo->user_comment) - 1) + 1;
+    memcpy(comment, code, sizeof(code));
+    memcpy(comment + sizeof(code), exifInfo->user_comment, commentsLen - 1);
+    comment[sizeof(code) + commentsLen - 1] = '\0';
+    writeExifIfd(&pCur, EXIF_TAG_USER_COMMENT, EXIF_TYPE_UNDEFINED,
+                 commentsLen + sizeof(code), comment, &LongerTagOffest, pIfdStart);
+    writeExifIfd(&pCur, EXIF_TAG_COLOR_SPACE, EXIF_TYPE_SHORT,
+                 1, exifInfo->color_space);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(color_space));
+    writeExifIfd(&pCur, EXIF_TAG_PIXEL_X_DIMENSION, EXIF_TYPE_LONG,
+                 1, exifInfo->width);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(width));
+    writeExifIfd(&pCur, EXIF_TAG_PIXEL_Y_DIMENSION, EXIF_TYPE_LONG,
+                 1, exifInfo->height);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(height));
+    writeExifIfd(&pCur, EXIF_TAG_EXPOSURE_MODE, EXIF_TYPE_LONG,
+                 1, exifInfo->exposure_mode);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(exposure_mode));
+    writeExifIfd(&pCur, EXIF_TAG_WHITE_BALANCE, EXIF_TYPE_LONG,
+                 1, exifInfo->white_balance);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(white_balance));
+    writeExifIfd(&pCur, EXIF_TAG_SCENCE_CAPTURE_TYPE, EXIF_TYPE_LONG,
+                 1, exifInfo->scene_capture_type);
+    addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(scene_capture_type));
+    tmp = 0;
+    memcpy(pCur, &tmp, OFFSET_SIZE); // next IFD offset
+    pCur += OFFSET_SIZE;
+
+    //2 0th IFD GPS Info Tags
+    tpl->gpsMethodLen = 0;
+    if (exifInfo->enableGps) {
+        writeExifIfd(&pGpsIfdPtr, EXIF_TAG_GPS_IFD_POINTER, EXIF_TYPE_LONG,
+                     1, LongerTagOffest); // GPS IFD pointer skipped on 0th IFD
+
+        pCur = pIfdStart + LongerTagOffest;
+
+        tpl->gpsMethodLen = strnlen((char *)exifInfo->gps_processing_method,
+                                    sizeof(exifInfo->gps_processing_method));
+        if (tpl->gpsMethodLen == 0) {
+            // don't create GPS_PROCESSING_METHOD tag if there isn't any
+            tmp = NUM_0TH_IFD_GPS - 1;
+        } else {
+            tmp = NUM_0TH_IFD_GPS;
+        }
+        memcpy(pCur, &tmp, NUM_SIZE);
+        pCur += NUM_SIZE;
+
+        LongerTagOffest += NUM_SIZE + tmp*IFD_SIZE + OFFSET_SIZE;
+
+        writeExifIfd(&pCur, EXIF_TAG_GPS_VERSION_ID, EXIF_TYPE_BYTE,
+                     4, exifInfo->gps_version_id);
+        addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(gps_version_id));
+        writeExifIfd(&pCur, EXIF_TAG_GPS_LATITUDE_REF, EXIF_TYPE_ASCII,
+                     2, exifInfo->gps_latitude_ref);
+        addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(gps_latitude_ref));
+        dataOffset = LongerTagOffest;
+        writeExifIfd(&pCur, EXIF_TAG_GPS_LATITUDE, EXIF_TYPE_RATIONAL,
+                     3, exifInfo->gps_latitude, &LongerTagOffest, pIfdStart);
+        addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(gps_latitude));
+        writeExifIfd(&pCur, EXIF_TAG_GPS_LONGITUDE_REF, EXIF_TYPE_ASCII,
+                     2, exifInfo->gps_longitude_ref);
+        addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(gps_longitude_ref));
+        dataOffset = LongerTagOffest;
+        writeExifIfd(&pCur, EXIF_TAG_GPS_LONGITUDE, EXIF_TYPE_RATIONAL,
+                     3, exifInfo->gps_longitude, &LongerTagOffest, pIfdStart);
+        addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(gps_longitude));
+        writeExifIfd(&pCur, EXIF_TAG_GPS_ALTITUDE_REF, EXIF_TYPE_BYTE,
+                     1, exifInfo->gps_altitude_ref);
+        addExifPatch(false, pCur - OFFSET_SIZE, EXIF_ATTR(gps_altitude_ref));
+        dataOffset = LongerTagOffest;
+        writeExifIfd(&pCur, EXIF_TAG_GPS_ALTITUDE, EXIF_TYPE_RATIONAL,
+                     1, &exifInfo->gps_altitude, &LongerTagOffest, pIfdStart);
+        addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(gps_altitude));
+        dataOffset = LongerTagOffest;
+        writeExifIfd(&pCur, EXIF_TAG_GPS_TIMESTAMP, EXIF_TYPE_RATIONAL,
+                     3, exifInfo->gps_timestamp, &LongerTagOffest, pIfdStart);
+        addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(gps_timestamp));
+        tmp = tpl->gpsMethodLen;
+        if (tmp > 0) {
+            if (tmp > 100) {
+                tmp = 100;
+            }
+            unsigned char tmp_buf[100+sizeof(ExifAsciiPrefix)];
+            memcpy(tmp_buf, ExifAsciiPrefix, sizeof(ExifAsciiPrefix));
+            memcpy(&tmp_buf[sizeof(ExifAsciiPrefix)], exifInfo->gps_processing_method, tmp);
+            dataOffset = LongerTagOffest;
+            writeExifIfd(&pCur, EXIF_TAG_GPS_PROCESSING_METHOD, EXIF_TYPE_UNDEFINED,
+                         tmp+sizeof(ExifAsciiPrefix), tmp_buf, &LongerTagOffest, pIfdStart);
+            addExifPatch(false, pIfdStart + dataOffset + sizeof(ExifAsciiPrefix),
+                         offsetof(exif_attribute_t, gps_processing_method), tmp);
+        }
+        dataOffset = LongerTagOffest;
+        writeExifIfd(&pCur, EXIF_TAG_GPS_DATESTAMP, EXIF_TYPE_ASCII,
+                     11, exifInfo->gps_datestamp, &LongerTagOffest, pIfdStart);
+        addExifPatch(false, pIfdStart + dataOffset, EXIF_ATTR(gps_datestamp));
+        tmp = 0;
+        memcpy(pCur, &tmp, OFFSET_SIZE); // next IFD offset
+        pCur += OFFSET_SIZE;
+    }
+
+    //2 1th IFD TIFF Tags, kept right after the 0th IFD data
+    exifSizeExceptThumb = LongerTagOffest;
+
+    pCur = pIfdStart + LongerTagOffest;
+
+    tmp = NUM_1TH_IFD_TIFF;
+    memcpy(pCur, &tmp, NUM_SIZE);
+    pCur += NUM_SIZE;
+
+    LongerTagOffest += NUM_SIZE + NUM_1TH_IFD_TIFF*IFD_SIZE + OFFSET_SIZE;
+
+    writeExifIfd(&pCur, EXIF_TAG_IMAGE_WIDTH, EXIF_TYPE_LONG,
+                 1, exifInfo->widthThumb);
+    addExifPatch(true, pCur - OFFSET_SIZE, EXIF_ATTR(widthThumb));
+    writeExifIfd(&pCur, EXIF_TAG_IMAGE_HEIGHT, EXIF_TYPE_LONG,
+                 1, exifInfo->heightThumb);
+    addExifPatch(true, pCur - OFFSET_SIZE, EXIF_ATTR(heightThumb));
+    writeExifIfd(&pCur, EXIF_TAG_COMPRESSION_SCHEME, EXIF_TYPE_SHORT,
+                 1, exifInfo->compression_scheme);
+    addExifPatch(true, pCur - OFFSET_SIZE, EXIF_ATTR(compression_scheme));
+    writeExifIfd(&pCur, EXIF_TAG_ORIENTATION, EXIF_TYPE_SHORT,
+                 1, exifInfo->orientation);
+    addExifPatch(true, pCur - OFFSET_SIZE, EXIF_ATTR(orientation));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_X_RESOLUTION, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->x_resolution, &LongerTagOffest, pIfdStart);
+    addExifPatch(true, pIfdStart + dataOffset, EXIF_ATTR(x_resolution));
+    dataOffset = LongerTagOffest;
+    writeExifIfd(&pCur, EXIF_TAG_Y_RESOLUTION, EXIF_TYPE_RATIONAL,
+                 1, &exifInfo->y_resolution, &LongerTagOffest, pIfdStart);
+    addExifPatch(true, pIfdStart + dataOffset, EXIF_ATTR(y_resolution));
+    writeExifIfd(&pCur, EXIF_TAG_RESOLUTION_UNIT, EXIF_TYPE_SHORT,
+                 1, exifInfo->resolution_unit);
+    addExifPatch(true, pCur - OFFSET_SIZE, EXIF_ATTR(resolution_unit));
+    writeExifIfd(&pCur, EXIF_TAG_JPEG_INTERCHANGE_FORMAT, EXIF_TYPE_LONG,
+                 1, LongerTagOffest);
+    writeExifIfd(&pCur, EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LEN, EXIF_TYPE_LONG,
+                 1, (uint32_t)0);
+    tpl->thumbLenPos = pCur - OFFSET_SIZE - tpl->seg;
+
+    tmp = 0;
+    memcpy(pCur, &tmp, OFFSET_SIZE); // next IFD offset
+    pCur += OFFSET_SIZE;
+
+    if (tpl->numPatch > EXIF_TEMPLATE_MAX_PATCH ||
+        tpl->numThumbPatch > EXIF_TEMPLATE_MAX_THUMB_PATCH) {
+        JPEG_ERROR_LOG("ERR(%s):too many patches(%d, %d)\n", __func__, tpl->numPatch, tpl->numThumbPatch);
+        return ERROR_MAKE_EXIF_FAIL;
+    }
+
+    tpl->segLen = 10 + exifSizeExceptThumb;
+    tpl->thumbIfdLen = LongerTagOffest - exifSizeExceptThumb;
+    tpl->nextIfdPos = pNextIfdOffset - tpl->seg;
+
+    tpl->enableGps = exifInfo->enableGps;
+    memcpy(tpl->maker, exifInfo->maker, sizeof(tpl->maker));
+    memcpy(tpl->model, exifInfo->model, sizeof(tpl->model));
+    memcpy(tpl->software, exifInfo->software, sizeof(tpl->software));
+    memcpy(tpl->user_comment, exifInfo->user_comment, sizeof(tpl->user_comment));
+
+    tpl->compileCount++;
+    tpl->valid = true;
+
+    ALOGV("DEBUG(%s):EXIF template compiled(%d bytes, %d patches), compile(%d) hit(%d)", __func__,
+        tpl->segLen, tpl->numPatch, tpl->compileCount, tpl->hitCount);
+
+    return ERROR_NONE;
+}
+
+unsigned int ExynosJpegEncoderForCamera::getExifTemplateSize(unsigned int thumbSize)
+{
+    exif_template_t *tpl = m_exifTemplate;
+    unsigned int exifSizeExceptThumb = tpl->segLen - 10;
+
+    // same limit as makeExif(), the thumbnail is dropped when it does not fit
+    if (thumbSize != 0 &&
+        exifSizeExceptThumb + tpl->thumbIfdLen + thumbSize <= EXIF_LIMIT_SIZE)
+        return tpl->segLen + tpl->thumbIfdLen + thumbSize;
+
+    return tpl->segLen;
+}
+
+void ExynosJpegEncoderForCamera::writeExifTemplate(unsigned char *exifOut,
+                                             exif_attribute_t *exifInfo,
+                                             char *thumbBuf,
+                                             unsigned int thumbSize)
+{
+    exif_template_t *tpl = m_exifTemplate;
+    unsigned char *pAttr = (unsigned char *)exifInfo;
+    unsigned int size = getExifTemplateSize(thumbSize);
+    unsigned int tmp;
+    int i;
+
+    if (size == tpl->segLen) {
+        memcpy(exifOut, tpl->seg, tpl->segLen);
+    } else {
+        memcpy(exifOut, tpl->seg, tpl->segLen + tpl->thumbIfdLen);
+    }
+
+    for (i = 0; i < tpl->numPatch; i++)
+        memcpy(exifOut + tpl->patch[i].dst, pAttr + tpl->patch[i].src, tpl->patch[i].len);
+
+    if (size != tpl->segLen) {
+        for (i = 0; i < tpl->numThumbPatch; i++)
+            memcpy(exifOut + tpl->thumbPatch[i].dst, pAttr + tpl->thumbPatch[i].src, tpl->thumbPatch[i].len);
+
+        memcpy(exifOut + tpl->thumbLenPos, &thumbSize, 4);
+
+        tmp = tpl->segLen - 10;
+        memcpy(exifOut + tpl->nextIfdPos, &tmp, OFFSET_SIZE);  // NEXT IFD offset skipped on 0th IFD
+
+        memcpy(exifOut + tpl->segLen + tpl->thumbIfdLen, thumbBuf, thumbSize);
+    }
+
+    exifOut[0] = 0xff;
+    exifOut[1] = 0xe1;
+
+    tmp = size - 2;    // APP1 Maker isn't counted
+    exifOut[2] = (tmp >> 8) & 0xFF;
+    exifOut[3] = tmp & 0xFF;
+}
+
 inline void ExynosJpegEncoderForCamera::writeExifIfd(unsigned char **pCur,
                                              unsigned short tag,
                                              unsigned short type,
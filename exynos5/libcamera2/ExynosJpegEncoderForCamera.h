@@ -27,6 +27,53 @@
 
 #define MAX_IMAGE_PLANE_NUM (3)
 
+#define EXIF_TEMPLATE_MAX_PATCH         (48)
+#define EXIF_TEMPLATE_MAX_THUMB_PATCH   (8)
+
+/*
+ * One per-shot value of a compiled EXIF template :
+ * copy 'len' bytes from offset 'src' of exif_attribute_t to offset 'dst' of the APP1 segment.
+ */
+typedef struct {
+    unsigned short dst;
+    unsigned short src;
+    unsigned short len;
+} exif_template_patch_t;
+
+/*
+ * Precompiled EXIF APP1 segment.
+ * The layout only depends on the attributes kept as key below, so it is compiled once
+ * and every other attribute is patched in place on each shot.
+ * The 1th IFD (thumbnail) is stored right after the 0th IFD data.
+ */
+typedef struct {
+    bool valid;
+
+    /* layout key */
+    bool enableGps;
+    unsigned char maker[32];
+    unsigned char model[32];
+    unsigned char software[32];
+    unsigned char user_comment[150];
+    unsigned int gpsMethodLen;
+
+    /* compiled segment */
+    unsigned char seg[EXIF_FILE_SIZE];
+    unsigned int segLen;
+    unsigned int thumbIfdLen;
+    unsigned int nextIfdPos;
+    unsigned int thumbLenPos;
+
+    int numPatch;
+    exif_template_patch_t patch[EXIF_TEMPLATE_MAX_PATCH];
+    int numThumbPatch;
+    exif_template_patch_t thumbPatch[EXIF_TEMPLATE_MAX_THUMB_PATCH];
+
+    unsigned int compileCount;
+    unsigned int hitCount;
+} exif_template_t;
+
+
 class ExynosJpegEncoderForCamera {
 public :
     ;
@@ -69,6 +116,12 @@ public :
         ERROR_NONE = 0
     };
 
+    enum EXIF_MODE {
+        EXIF_MODE_BUILD = 0,    /* rebuild the whole IFD tree on every shot */
+        EXIF_MODE_TEMPLATE,     /* patch the compiled template into a temporary buffer */
+        EXIF_MODE_DIRECT,       /* patch the compiled template into the JPEG output buffer */
+    };
+
     ExynosJpegEncoderForCamera();
     virtual ~ExynosJpegEncoderForCamera();
 
@@ -96,6 +149,13 @@ public :
                                unsigned int *size,
                                bool useMainbufForThumb = false);
 
+    int     setExifTemplate(exif_template_t *exifTemplate);
+    int     setExifMode(int mode);
+    int     makeExifFromTemplate(unsigned char *exifOut,
+                               exif_attribute_t *exifIn,
+                               unsigned int *size,
+                               bool useMainbufForThumb = false);
+
 private:
     inline void writeExifIfd(unsigned char **pCur,
                                          unsigned short tag,
@@ -121,6 +181,21 @@ private:
                                          unsigned char *pValue,
                                          unsigned int *offset,
                                          unsigned char *start);
+    bool    checkExifTemplate(exif_attribute_t *exifInfo);
+    int     compileExifTemplate(exif_attribute_t *exifInfo);
+    inline void addExifPatch(bool thumb,
+                                         unsigned char *pDst,
+                                         unsigned int src,
+                                         unsigned int len);
+    unsigned int getExifTemplateSize(unsigned int thumbSize);
+    void    writeExifTemplate(unsigned char *exifOut, exif_attribute_t *exifInfo,
+                                          char *thumbBuf, unsigned int thumbSize);
+    void    getThumbnailOutBuf(bool useMainbufForThumb, char **thumbBuf, unsigned int *thumbSize);
+#ifdef EXIF_TEMPLATE_VERIFY
+    void    verifyExifTemplate(unsigned char *exifOut, unsigned int size,
+                                          exif_attribute_t *exifInfo, bool useMainbufForThumb,
+                                          unsigned int thumbSize);
+#endif
     int     scaleDownYuv422(char **srcBuf, unsigned int srcW, unsigned int srcH,
                                                 char **dstBuf, unsigned int dstW, unsigned int dstH);
     int     scaleDownYuv422_2p(char **srcBuf, unsigned int srcW, unsigned int srcH,
@@ -155,6 +230,9 @@ private:
     int m_thumbnailW;
     int m_thumbnailH;
     int m_thumbnailQuality;
+
+    exif_template_t *m_exifTemplate;
+    int m_exifMode;
 };
 
 #endif /* __SEC_JPG_ENC_H__ */
@@ -8,7 +8,9 @@ LOCAL_SRC_FILES:=                       \
         DashPlayer.cpp                  \
         DashPlayerDriver.cpp            \
         DashPlayerRenderer.cpp          \
+        DashPlayerTextRenderer.cpp      \
         DashPlayerStats.cpp             \
+        DashPlayerAbrController.cpp     \
         DashPlayerDecoder.cpp           \
         DashPacketSource.cpp            \
         DashFactory.cpp                 \
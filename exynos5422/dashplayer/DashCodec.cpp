@@ -397,6 +397,8 @@ DashCodec::DashCodec()
       mMetaDataBuffersToSubmit(0),
       mCurrentWidth(0),
       mCurrentHeight(0),
+      mInputBytesCopied(0),
+      mInputBytesInPlace(0),
       mAdaptivePlayback(false) {
     mUninitializedState = new UninitializedState(this);
     mLoadedState = new LoadedState(this);
@@ -414,6 +416,7 @@ DashCodec::DashCodec()
 
     mPortEOS[kPortIndexInput] = mPortEOS[kPortIndexOutput] = false;
     mInputEOSResult = OK;
+    memset(mBufferCounts, 0, sizeof(mBufferCounts));
 
     changeState(mUninitializedState);
 }
@@ -534,6 +537,8 @@ status_t DashCodec::allocateBuffersOnPort(OMX_U32 portIndex) {
         }
     }
 
+    indexBuffersOnPort(portIndex);
+
     if (err != OK) {
         return err;
     }
@@ -739,6 +744,9 @@ status_t DashCodec::allocateOutputBuffersFromNativeWindow() {
         cancelEnd = bufferCount;
     }
 
+    // The cancels below go through the ownership counters
+    indexBuffersOnPort(kPortIndexOutput);
+
     for (OMX_U32 i = cancelStart; i < cancelEnd; i++) {
         BufferInfo *info = &mBuffers[kPortIndexOutput].editItemAt(i);
         cancelBufferToNativeWindow(info);
@@ -802,7 +810,7 @@ status_t DashCodec::submitOutputMetaDataBuffer() {
     CHECK_EQ(mOMX->fillBuffer(mNode, info->mBufferID),
              (status_t)OK);
 
-    info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+    setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_COMPONENT);
     return OK;
 }
 
@@ -817,7 +825,7 @@ status_t DashCodec::cancelBufferToNativeWindow(BufferInfo *info) {
 
     CHECK_EQ(err, 0);
 
-    info->mStatus = BufferInfo::OWNED_BY_NATIVE_WINDOW;
+    setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_NATIVE_WINDOW);
 
     return OK;
 }
@@ -831,27 +839,34 @@ DashCodec::BufferInfo *DashCodec::dequeueBufferFromNativeWindow() {
         return NULL;
     }
 
+    ssize_t index = mGraphicBufferIndex.indexOfKey(buf->handle);
+    if (index >= 0) {
+        BufferInfo *info = &mBuffers[kPortIndexOutput].editItemAt(
+                mGraphicBufferIndex.valueAt(index));
+
+        CHECK_EQ((int)info->mStatus,
+                 (int)BufferInfo::OWNED_BY_NATIVE_WINDOW);
+
+        setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_US);
+
+        return info;
+    }
+
+    // A graphic buffer we have not seen yet, which only metadata mode
+    // allows: it takes over the least recently dequeued slot.
     BufferInfo *oldest = NULL;
+    size_t oldestIndex = 0;
     for (size_t i = mBuffers[kPortIndexOutput].size(); i-- > 0;) {
         BufferInfo *info =
             &mBuffers[kPortIndexOutput].editItemAt(i);
 
-        if (info->mGraphicBuffer != NULL &&
-            info->mGraphicBuffer->handle == buf->handle) {
-            CHECK_EQ((int)info->mStatus,
-                     (int)BufferInfo::OWNED_BY_NATIVE_WINDOW);
-
-            info->mStatus = BufferInfo::OWNED_BY_US;
-
-            return info;
-        }
-
         if (info->mStatus == BufferInfo::OWNED_BY_NATIVE_WINDOW &&
             (oldest == NULL ||
              // avoid potential issues from counter rolling over
              mDequeueCounter - info->mDequeuedAt >
                     mDequeueCounter - oldest->mDequeuedAt)) {
             oldest = info;
+            oldestIndex = i;
         }
     }
 
@@ -859,8 +874,12 @@ DashCodec::BufferInfo *DashCodec::dequeueBufferFromNativeWindow() {
         CHECK(mStoreMetaDataInOutputBuffers);
 
         // discard buffer in LRU info and replace with new buffer
+        if (oldest->mGraphicBuffer != NULL) {
+            mGraphicBufferIndex.removeItem(oldest->mGraphicBuffer->handle);
+        }
         oldest->mGraphicBuffer = new GraphicBuffer(buf, false);
-        oldest->mStatus = BufferInfo::OWNED_BY_US;
+        mGraphicBufferIndex.add(oldest->mGraphicBuffer->handle, oldestIndex);
+        setBufferStatus(kPortIndexOutput, oldest, BufferInfo::OWNED_BY_US);
 
         mOMX->updateGraphicBufferInMeta(
                   mNode, kPortIndexOutput, oldest->mGraphicBuffer,
@@ -885,6 +904,11 @@ DashCodec::BufferInfo *DashCodec::dequeueBufferFromNativeWindow() {
 }
 
 status_t DashCodec::freeBuffersOnPort(OMX_U32 portIndex) {
+    if (portIndex == kPortIndexInput) {
+        ALOGI("[%s] input bytes copied %lld, written in place %lld",
+             mComponentName.c_str(), mInputBytesCopied, mInputBytesInPlace);
+    }
+
     for (size_t i = mBuffers[portIndex].size(); i-- > 0;) {
         CHECK_EQ((status_t)OK, freeBuffer(portIndex, i));
     }
@@ -926,27 +950,53 @@ status_t DashCodec::freeBuffer(OMX_U32 portIndex, size_t i) {
              (status_t)OK);
 
     mBuffers[portIndex].removeAt(i);
+    indexBuffersOnPort(portIndex);
 
     return OK;
 }
 
-DashCodec::BufferInfo *DashCodec::findBufferByID(
-        uint32_t portIndex, IOMX::buffer_id bufferID,
-        ssize_t *index) {
+void DashCodec::indexBuffersOnPort(OMX_U32 portIndex) {
+    mBufferIndex[portIndex].clear();
+    memset(mBufferCounts[portIndex], 0, sizeof(mBufferCounts[portIndex]));
+    if (portIndex == kPortIndexOutput) {
+        mGraphicBufferIndex.clear();
+    }
+
     for (size_t i = 0; i < mBuffers[portIndex].size(); ++i) {
-        BufferInfo *info = &mBuffers[portIndex].editItemAt(i);
+        const BufferInfo &info = mBuffers[portIndex][i];
 
-        if (info->mBufferID == bufferID) {
-            if (index != NULL) {
-                *index = i;
-            }
-            return info;
+        mBufferIndex[portIndex].add(info.mBufferID, i);
+        ++mBufferCounts[portIndex][info.mStatus];
+
+        if (portIndex == kPortIndexOutput && info.mGraphicBuffer != NULL) {
+            mGraphicBufferIndex.add(info.mGraphicBuffer->handle, i);
         }
     }
+}
 
-    TRESPASS();
+void DashCodec::setBufferStatus(
+        OMX_U32 portIndex, BufferInfo *info, BufferInfo::Status status) {
+    --mBufferCounts[portIndex][info->mStatus];
+    ++mBufferCounts[portIndex][status];
+    info->mStatus = status;
+}
 
-    return NULL;
+DashCodec::BufferInfo *DashCodec::findBufferByID(
+        uint32_t portIndex, IOMX::buffer_id bufferID,
+        ssize_t *index) {
+    ssize_t i = mBufferIndex[portIndex].indexOfKey(bufferID);
+
+    if (i < 0) {
+        TRESPASS();
+
+        return NULL;
+    }
+
+    size_t pos = mBufferIndex[portIndex].valueAt(i);
+    if (index != NULL) {
+        *index = pos;
+    }
+    return &mBuffers[portIndex].editItemAt(pos);
 }
 
 status_t DashCodec::setComponentRole(
@@ -2354,31 +2404,11 @@ status_t DashCodec::initNativeWindow() {
 }
 
 size_t DashCodec::countBuffersOwnedByComponent(OMX_U32 portIndex) const {
-    size_t n = 0;
-
-    for (size_t i = 0; i < mBuffers[portIndex].size(); ++i) {
-        const BufferInfo &info = mBuffers[portIndex].itemAt(i);
-
-        if (info.mStatus == BufferInfo::OWNED_BY_COMPONENT) {
-            ++n;
-        }
-    }
-
-    return n;
+    return mBufferCounts[portIndex][BufferInfo::OWNED_BY_COMPONENT];
 }
 
 size_t DashCodec::countBuffersOwnedByNativeWindow() const {
-    size_t n = 0;
-
-    for (size_t i = 0; i < mBuffers[kPortIndexOutput].size(); ++i) {
-        const BufferInfo &info = mBuffers[kPortIndexOutput].itemAt(i);
-
-        if (info.mStatus == BufferInfo::OWNED_BY_NATIVE_WINDOW) {
-            ++n;
-        }
-    }
-
-    return n;
+    return mBufferCounts[kPortIndexOutput][BufferInfo::OWNED_BY_NATIVE_WINDOW];
 }
 
 void DashCodec::waitUntilAllPossibleNativeWindowBuffersAreReturnedToUs() {
@@ -2409,16 +2439,14 @@ void DashCodec::waitUntilAllPossibleNativeWindowBuffersAreReturnedToUs() {
 
 bool DashCodec::allYourBuffersAreBelongToUs(
         OMX_U32 portIndex) {
-    for (size_t i = 0; i < mBuffers[portIndex].size(); ++i) {
-        BufferInfo *info = &mBuffers[portIndex].editItemAt(i);
+    size_t owned = mBufferCounts[portIndex][BufferInfo::OWNED_BY_US]
+        + mBufferCounts[portIndex][BufferInfo::OWNED_BY_NATIVE_WINDOW];
 
-        if (info->mStatus != BufferInfo::OWNED_BY_US
-                && info->mStatus != BufferInfo::OWNED_BY_NATIVE_WINDOW) {
-            ALOGV("[%s] Buffer %p on port %ld still has status %d",
-                    mComponentName.c_str(),
-                    info->mBufferID, portIndex, info->mStatus);
-            return false;
-        }
+    if (owned != mBuffers[portIndex].size()) {
+        ALOGV("[%s] %d of %d buffers on port %ld still not returned",
+                mComponentName.c_str(), mBuffers[portIndex].size() - owned,
+                mBuffers[portIndex].size(), portIndex);
+        return false;
     }
 
     return true;
@@ -2974,7 +3002,7 @@ bool DashCodec::BaseState::onOMXEmptyBufferDone(IOMX::buffer_id bufferID) {
         mCodec->findBufferByID(kPortIndexInput, bufferID);
 
     CHECK_EQ((int)info->mStatus, (int)BufferInfo::OWNED_BY_COMPONENT);
-    info->mStatus = BufferInfo::OWNED_BY_US;
+    mCodec->setBufferStatus(kPortIndexInput, info, BufferInfo::OWNED_BY_US);
 
     const sp<AMessage> &bufferMeta = info->mData->meta();
     void *mediaBuffer;
@@ -3036,7 +3064,7 @@ void DashCodec::BaseState::postFillThisBuffer(BufferInfo *info) {
 
     notify->post();
 
-    info->mStatus = BufferInfo::OWNED_BY_UPSTREAM;
+    mCodec->setBufferStatus(kPortIndexInput, info, BufferInfo::OWNED_BY_UPSTREAM);
 }
 
 void DashCodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
@@ -3067,7 +3095,7 @@ void DashCodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
     BufferInfo *info = mCodec->findBufferByID(kPortIndexInput, bufferID);
     CHECK_EQ((int)info->mStatus, (int)BufferInfo::OWNED_BY_UPSTREAM);
 
-    info->mStatus = BufferInfo::OWNED_BY_US;
+    mCodec->setBufferStatus(kPortIndexInput, info, BufferInfo::OWNED_BY_US);
 
     PortMode mode = getPortMode(kPortIndexInput);
 
@@ -3108,6 +3136,9 @@ void DashCodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
 
                     CHECK_LE(buffer->size(), info->mData->capacity());
                     memcpy(info->mData->data(), buffer->data(), buffer->size());
+                    mCodec->mInputBytesCopied += buffer->size();
+                } else {
+                    mCodec->mInputBytesInPlace += buffer->size();
                 }
 
                 if (flags & OMX_BUFFERFLAG_CODECCONFIG) {
@@ -3156,7 +3187,7 @@ void DashCodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                             timeUs),
                          (status_t)OK);
 
-                info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+                mCodec->setBufferStatus(kPortIndexInput, info, BufferInfo::OWNED_BY_COMPONENT);
 
                 if (!eos) {
                     getMoreInputDataIfPossible();
@@ -3203,7 +3234,7 @@ void DashCodec::BaseState::onInputBufferFilled(const sp<AMessage> &msg) {
                             0),
                          (status_t)OK);
 
-                info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+                mCodec->setBufferStatus(kPortIndexInput, info, BufferInfo::OWNED_BY_COMPONENT);
 
                 mCodec->mPortEOS[kPortIndexInput] = true;
                 mCodec->mInputEOSResult = err;
@@ -3279,7 +3310,7 @@ bool DashCodec::BaseState::onOMXFillBufferDone(
     CHECK_EQ((int)info->mStatus, (int)BufferInfo::OWNED_BY_COMPONENT);
 
     info->mDequeuedAt = ++mCodec->mDequeueCounter;
-    info->mStatus = BufferInfo::OWNED_BY_US;
+    mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_US);
 
     PortMode mode = getPortMode(kPortIndexOutput);
 
@@ -3297,7 +3328,7 @@ bool DashCodec::BaseState::onOMXFillBufferDone(
                             mCodec->mNode, info->mBufferID),
                          (status_t)OK);
 
-                info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+                mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_COMPONENT);
                 break;
             }
 
@@ -3400,7 +3431,7 @@ bool DashCodec::BaseState::onOMXFillBufferDone(
 
             notify->post();
 
-            info->mStatus = BufferInfo::OWNED_BY_DOWNSTREAM;
+            mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_DOWNSTREAM);
 
             break;
         }
@@ -3439,17 +3470,23 @@ void DashCodec::BaseState::onOutputBufferDrained(const sp<AMessage> &msg) {
             && msg->findInt32("render", &render) && render != 0) {
         // The client wants this buffer to be rendered.
 
+        int64_t timestampNs;
+        if (msg->findInt64("timestampNs", &timestampNs)) {
+            native_window_set_buffers_timestamp(
+                    mCodec->mNativeWindow.get(), timestampNs);
+        }
+
         status_t err;
         if ((err = mCodec->mNativeWindow->queueBuffer(
                     mCodec->mNativeWindow.get(),
                     info->mGraphicBuffer.get(), -1)) == OK) {
-            info->mStatus = BufferInfo::OWNED_BY_NATIVE_WINDOW;
+            mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_NATIVE_WINDOW);
         } else {
             mCodec->signalError(OMX_ErrorUndefined, err);
-            info->mStatus = BufferInfo::OWNED_BY_US;
+            mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_US);
         }
     } else {
-        info->mStatus = BufferInfo::OWNED_BY_US;
+        mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_US);
     }
 
     PortMode mode = getPortMode(kPortIndexOutput);
@@ -3485,7 +3522,7 @@ void DashCodec::BaseState::onOutputBufferDrained(const sp<AMessage> &msg) {
                     CHECK_EQ(mCodec->mOMX->fillBuffer(mCodec->mNode, info->mBufferID),
                              (status_t)OK);
 
-                    info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+                    mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_COMPONENT);
                 }
             }
             break;
@@ -3967,7 +4004,7 @@ void DashCodec::ExecutingState::submitRegularOutputBuffers() {
         CHECK_EQ(mCodec->mOMX->fillBuffer(mCodec->mNode, info->mBufferID),
                  (status_t)OK);
 
-        info->mStatus = BufferInfo::OWNED_BY_COMPONENT;
+        mCodec->setBufferStatus(kPortIndexOutput, info, BufferInfo::OWNED_BY_COMPONENT);
     }
 }
 
@@ -151,6 +151,10 @@ private:
         sp<GraphicBuffer> mGraphicBuffer;
     };
 
+    enum {
+        kNumBufferStatus = BufferInfo::OWNED_BY_NATIVE_WINDOW + 1
+    };
+
 #if TRACK_BUFFER_TIMING
     struct BufferStats {
         int64_t mEmptyBufferTimeUs;
@@ -184,6 +188,14 @@ private:
     sp<ANativeWindow> mNativeWindow;
 
     Vector<BufferInfo> mBuffers[2];
+    // Position in mBuffers by buffer ID, rebuilt whenever a port's
+    // buffers are allocated or freed.
+    KeyedVector<IOMX::buffer_id, size_t> mBufferIndex[2];
+    // Output buffer position by graphic buffer handle, and the number of
+    // buffers in each status per port. Rebuilt along with mBufferIndex,
+    // kept up to date in between by setBufferStatus().
+    KeyedVector<buffer_handle_t, size_t> mGraphicBufferIndex;
+    size_t mBufferCounts[2][kNumBufferStatus];
     bool mPortEOS[2];
     status_t mInputEOSResult;
 
@@ -211,9 +223,17 @@ private:
     int32_t mCurrentWidth;
     int32_t mCurrentHeight;
 
+    // Input payload copied into our buffers versus payload upstream
+    // already wrote into them.
+    int64_t mInputBytesCopied;
+    int64_t mInputBytesInPlace;
+
     status_t allocateBuffersOnPort(OMX_U32 portIndex);
     status_t freeBuffersOnPort(OMX_U32 portIndex);
     status_t freeBuffer(OMX_U32 portIndex, size_t i);
+    void indexBuffersOnPort(OMX_U32 portIndex);
+    void setBufferStatus(
+            OMX_U32 portIndex, BufferInfo *info, BufferInfo::Status status);
 
     status_t configureOutputBuffersFromNativeWindow(
             OMX_U32 *nBufferCount, OMX_U32 *nBufferSize,
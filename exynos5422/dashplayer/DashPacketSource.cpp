@@ -27,10 +27,41 @@
 #include <media/stagefright/MediaBuffer.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MetaData.h>
+#include <utils/KeyedVector.h>
 #include <utils/Vector.h>
 
 namespace android {
 
+// Queued access units between two discontinuities. There is always at
+// least one segment, the back one receives newly queued access units.
+struct DashPacketSource::Accounting {
+    struct Segment {
+        Segment() : mFirstTimeUs(-1), mLastTimeUs(-1), mBytes(0) {}
+
+        int64_t mFirstTimeUs;   // -1 while the segment is empty
+        int64_t mLastTimeUs;
+        size_t mBytes;
+    };
+
+    Accounting() : mBufferedBytes(0) {
+        clear();
+    }
+
+    void clear() {
+        mSegments.clear();
+        mSegments.push_back(Segment());
+        mBufferedBytes = 0;
+    }
+
+    List<Segment> mSegments;
+    size_t mBufferedBytes;
+};
+
+// Accounting of every live DashPacketSource, entries are added and removed
+// by the constructor and destructor only.
+static Mutex gAccountingLock;
+static KeyedVector<const DashPacketSource *, DashPacketSource::Accounting *> gAccounting;
+
 DashPacketSource::DashPacketSource(const sp<MetaData> &meta)
     : mIsAudio(false),
       mFormat(meta),
@@ -38,6 +69,11 @@ DashPacketSource::DashPacketSource(const sp<MetaData> &meta)
       mStreamPID(0),
       mProgramPID(0),
       mFirstPTS(0) {
+    {
+        Mutex::Autolock autoLock(gAccountingLock);
+        gAccounting.add(this, new Accounting);
+    }
+
     const char *mime;
     CHECK(meta->findCString(kKeyMIMEType, &mime));
 
@@ -58,6 +94,17 @@ void DashPacketSource::updateFormat(const sp<MetaData> &meta) {
 }
 
 DashPacketSource::~DashPacketSource() {
+    Mutex::Autolock autoLock(gAccountingLock);
+    ssize_t index = gAccounting.indexOfKey(this);
+    if (index >= 0) {
+        delete gAccounting.valueAt(index);
+        gAccounting.removeItemsAt(index);
+    }
+}
+
+DashPacketSource::Accounting *DashPacketSource::accounting_l() {
+    Mutex::Autolock autoLock(gAccountingLock);
+    return gAccounting.valueFor(this);
 }
 
 status_t DashPacketSource::start(MetaData * /*params*/) {
@@ -97,6 +144,7 @@ status_t DashPacketSource::dequeueAccessUnit(sp<ABuffer> *buffer) {
     if (!mBuffers.empty()) {
         *buffer = *mBuffers.begin();
         mBuffers.erase(mBuffers.begin());
+        onBufferDequeued_l(*buffer);
 
         int32_t discontinuity;
         if ((*buffer)->meta()->findInt32("discontinuity", &discontinuity)) {
@@ -125,6 +173,7 @@ status_t DashPacketSource::read(
     if (!mBuffers.empty()) {
         const sp<ABuffer> buffer = *mBuffers.begin();
         mBuffers.erase(mBuffers.begin());
+        onBufferDequeued_l(buffer);
 
         int32_t discontinuity;
         if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
@@ -149,6 +198,34 @@ status_t DashPacketSource::read(
     return mEOSResult;
 }
 
+void DashPacketSource::onBufferDequeued_l(const sp<ABuffer> &buffer) {
+    Accounting *accounting = accounting_l();
+    Accounting::Segment &front = *accounting->mSegments.begin();
+
+    int32_t discontinuity;
+    if (buffer->meta()->findInt32("discontinuity", &discontinuity)) {
+        // Everything before the discontinuity has been dequeued already.
+        CHECK(front.mFirstTimeUs < 0);
+        if (accounting->mSegments.begin() != --accounting->mSegments.end()) {
+            accounting->mSegments.erase(accounting->mSegments.begin());
+        }
+        return;
+    }
+
+    front.mBytes -= buffer->size();
+    accounting->mBufferedBytes -= buffer->size();
+
+    // The segment now starts at the next queued access unit, if any.
+    int64_t timeUs;
+    if (!mBuffers.empty()
+            && (*mBuffers.begin())->meta()->findInt64("timeUs", &timeUs)) {
+        front.mFirstTimeUs = timeUs;
+    } else {
+        front.mFirstTimeUs = -1;
+        front.mLastTimeUs = -1;
+    }
+}
+
 bool DashPacketSource::wasFormatChange(
         int32_t discontinuityType) const {
     if (mIsAudio) {
@@ -171,6 +248,16 @@ void DashPacketSource::queueAccessUnit(const sp<ABuffer> &buffer) {
 
     Mutex::Autolock autoLock(mLock);
     mBuffers.push_back(buffer);
+
+    Accounting *accounting = accounting_l();
+    Accounting::Segment &back = *--accounting->mSegments.end();
+    if (back.mFirstTimeUs < 0) {
+        back.mFirstTimeUs = timeUs;
+    }
+    back.mLastTimeUs = timeUs;
+    back.mBytes += buffer->size();
+    accounting->mBufferedBytes += buffer->size();
+
     ALOGV("@@@@:: DashPacketSource --> size is %d ",mBuffers.size() );
     mCondition.signal();
 }
@@ -188,6 +275,7 @@ void DashPacketSource::queueDiscontinuity(
         type == ATSParser::DISCONTINUITY_SEEK) {
         ALOGI("Flushing all Access units for seek");
         mBuffers.clear();
+        accounting_l()->clear();
         mEOSResult = OK;
         mCondition.signal();
         return;
@@ -200,6 +288,8 @@ void DashPacketSource::queueDiscontinuity(
     buffer->meta()->setMessage("extra", extra);
 
     mBuffers.push_back(buffer);
+    accounting_l()->mSegments.push_back(Accounting::Segment());
+
     mCondition.signal();
 }
 
@@ -226,33 +316,20 @@ int64_t DashPacketSource::getBufferedDurationUs(status_t *finalResult) {
 
     *finalResult = mEOSResult;
 
-    if (mBuffers.empty()) {
+    const Accounting *accounting = accounting_l();
+    const Accounting::Segment &back = *--accounting->mSegments.end();
+    if (back.mFirstTimeUs < 0) {
         return 0;
     }
 
-    int64_t time1 = -1;
-    int64_t time2 = -1;
-
-    List<sp<ABuffer> >::iterator it = mBuffers.begin();
-    while (it != mBuffers.end()) {
-        const sp<ABuffer> &buffer = *it;
-
-        int64_t timeUs;
-        if (buffer->meta()->findInt64("timeUs", &timeUs)) {
-            if (time1 < 0) {
-                time1 = timeUs;
-            }
-
-            time2 = timeUs;
-        } else {
-            // This is a discontinuity, reset everything.
-            time1 = time2 = -1;
-        }
+    return back.mLastTimeUs - back.mFirstTimeUs;
+}
 
-        ++it;
-    }
+size_t DashPacketSource::getBufferedBytes(status_t *finalResult) {
+    Mutex::Autolock autoLock(mLock);
 
-    return time2 - time1;
+    *finalResult = mEOSResult;
+    return accounting_l()->mBufferedBytes;
 }
 
 status_t DashPacketSource::nextBufferTime(int64_t *timeUs) {
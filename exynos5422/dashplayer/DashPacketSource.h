@@ -50,6 +50,9 @@ struct DashPacketSource : public MediaSource {
     // presentation timestamps since the last discontinuity (if any).
     int64_t getBufferedDurationUs(status_t *finalResult);
 
+    // Returns the payload size of all queued access units.
+    size_t getBufferedBytes(status_t *finalResult);
+
     status_t nextBufferTime(int64_t *timeUs);
 
     void queueAccessUnit(const sp<ABuffer> &buffer);
@@ -69,6 +72,12 @@ struct DashPacketSource : public MediaSource {
 
     status_t nextBufferIsSync(bool* isSyncFrame);
 
+    // Buffered duration and byte accounting. libmmipstreamaal allocates
+    // this object itself, so new state must not change its layout until
+    // that library is rebuilt against this header; it is kept in a table
+    // outside of the object instead.
+    struct Accounting;
+
 protected:
     virtual ~DashPacketSource();
 
@@ -86,6 +95,9 @@ private:
 
     bool wasFormatChange(int32_t discontinuityType) const;
 
+    Accounting *accounting_l();
+    void onBufferDequeued_l(const sp<ABuffer> &buffer);
+
     DISALLOW_EVIL_CONSTRUCTORS(DashPacketSource);
 };
 
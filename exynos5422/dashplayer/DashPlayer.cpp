@@ -32,6 +32,7 @@
 #include "DashPlayerDecoder.h"
 #include "DashPlayerDriver.h"
 #include "DashPlayerRenderer.h"
+#include "DashPlayerTextRenderer.h"
 #include "DashPlayerSource.h"
 #include "DashCodec.h"
 //#include "RTSPSource.h"
@@ -43,6 +44,7 @@
 #include <media/stagefright/foundation/hexdump.h>
 #include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/MediaDefs.h>
@@ -60,6 +62,14 @@
 
 namespace android {
 
+// Minimum spacing of buffered duration samples handed to the ABR controller
+static const int64_t kAbrSampleIntervalUs = 500000ll;
+
+// Largest video DashCodec prepares adaptive playback for, see MAX_WIDTH
+// and MAX_HEIGHT in DashCodec.cpp
+static const int32_t kAdaptiveMaxWidth = 1920;
+static const int32_t kAdaptiveMaxHeight = 1080;
+
 struct DashPlayer::Action : public RefBase {
     Action() {}
 
@@ -137,9 +147,12 @@ DashPlayer::DashPlayer()
       mFlushingVideo(NONE),
       mResetInProgress(false),
       mResetPostponed(false),
+      mResetAwaitingEviction(false),
       mSetVideoSize(true),
       mSkipRenderingAudioUntilMediaTimeUs(-1ll),
       mSkipRenderingVideoUntilMediaTimeUs(-1ll),
+      mInBufferSeekEnabled(false),
+      mDecoderPoolIdleUs(10000000ll),
       mVideoLateByUs(0ll),
       mNumFramesTotal(0ll),
       mNumFramesDropped(0ll),
@@ -148,10 +161,27 @@ DashPlayer::DashPlayer()
       mIsSecureInputBuffers(false),
       mSRid(0),
       mStats(NULL),
+      mAbrController(new DashPlayerAbrController),
+      mLastAbrSampleUs(-1ll),
+      mSourceReportsBufferLevel(true),
       mTimedTextCEAPresent(false),
       mTimedTextCEASamplesDisc(false),
       mQCTimedTextListenerPresent(false){
       mTrackName = new char[6];
+
+      char property_value[PROPERTY_VALUE_MAX] = {0};
+      if (property_get("persist.dash.seek.inbuffer", property_value, NULL) > 0) {
+          mInBufferSeekEnabled = atoi(property_value) > 0;
+      }
+
+      // 0 disables the decoder pool
+      if (property_get("persist.dash.decoder.pool.idle.ms", property_value, NULL) > 0) {
+          mDecoderPoolIdleUs = atoll(property_value) * 1000ll;
+      }
+
+      mPoolDecoderOnShutdown[kVideo] = mPoolDecoderOnShutdown[kAudio] = false;
+      mDecoderPool[kVideo].mGeneration = mDecoderPool[kAudio].mGeneration = 0;
+      mSourceFillsInputBuffer[kVideo] = mSourceFillsInputBuffer[kAudio] = false;
 }
 
 DashPlayer::~DashPlayer() {
@@ -167,6 +197,24 @@ DashPlayer::~DashPlayer() {
     if (mTextDecoder != NULL) {
       looper()->unregisterHandler(mTextDecoder->id());
     }
+    // finishReset has normally shut the pooled decoders down already
+    for (int track = kVideo; track <= kAudio; ++track) {
+      if (mDecoderPool[track].mDecoder != NULL) {
+        mDecoderPool[track].mDecoder->initiateShutdown();
+        looper()->unregisterHandler(mDecoderPool[track].mDecoder->id());
+        mDecoderPool[track].mDecoder.clear();
+      }
+      for (List<sp<Decoder> >::iterator it = mEvictedDecoders[track].begin();
+           it != mEvictedDecoders[track].end(); ++it) {
+        looper()->unregisterHandler((*it)->id());
+      }
+      mEvictedDecoders[track].clear();
+    }
+    if (mTextLooper != NULL) {
+      mTextLooper->unregisterHandler(mTextRenderer->id());
+      mTextLooper->stop();
+      mTextLooper.clear();
+    }
     if(mStats != NULL) {
         mStats->logFpsSummary();
         mStats = NULL;
@@ -428,6 +476,15 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                 mRenderer->registerStats(mStats);
                 looper()->registerHandler(mRenderer);
 
+            if (mTextLooper == NULL) {
+                mTextLooper = new ALooper;
+                mTextLooper->setName("dashplayer-text");
+                mTextLooper->start();
+
+                mTextRenderer = new TextRenderer(mDriver);
+                mTextLooper->registerHandler(mTextRenderer);
+            }
+
             postScanSources();
             break;
         }
@@ -609,7 +666,28 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
 
                 ALOGV("decoder %s flush completed", mTrackName);
 
-                if (needShutdown) {
+                bool poolDecoder = false;
+                if (track == kAudio || track == kVideo) {
+                    poolDecoder = mPoolDecoderOnShutdown[track]
+                            && mDecoderPoolIdleUs > 0
+                            && !mResetInProgress && !mResetPostponed;
+                    mPoolDecoderOnShutdown[track] = false;
+                }
+
+                if (needShutdown && poolDecoder) {
+                    // Flushed decoder stays configured, no shutdown to wait for
+                    ALOGV("keeping %s decoder for reuse", mTrackName);
+
+                    if (track == kAudio) {
+                        parkDecoder(kAudio, mAudioDecoder);
+                        mAudioDecoder.clear();
+                        mFlushingAudio = SHUT_DOWN;
+                    } else {
+                        parkDecoder(kVideo, mVideoDecoder);
+                        mVideoDecoder.clear();
+                        mFlushingVideo = SHUT_DOWN;
+                    }
+                } else if (needShutdown) {
                     ALOGV("initiating %s decoder shutdown",
                            mTrackName);
 
@@ -801,6 +879,10 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                 CHECK(msg->findInt64("positionUs", &positionUs));
 
                 CHECK(msg->findInt64("videoLateByUs", &mVideoLateByUs));
+
+                if (mTextRenderer != NULL) {
+                    mTextRenderer->updatePosition(positionUs);
+                }
                 ALOGV("@@@@:: Dashplayer :: MESSAGE FROM RENDERER ***************** kWhatPosition:: position(%lld) VideoLateBy(%lld)",positionUs,mVideoLateByUs);
 
                 if (mDriver != NULL) {
@@ -892,7 +974,25 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
             ALOGE("kWhatSeek seekTimeUs=%lld us (%.2f secs)",
                  seekTimeUs, seekTimeUs / 1E6);
 
-            nRet = mSource->seekTo(seekTimeUs);
+            // Targets inside the queued data only need the decoders flushed,
+            // the source keeps everything from the preceding sync sample on.
+            bool inBufferSeek = false;
+            if (mSourceType == kHttpDashSource && mInBufferSeekEnabled
+                    && mFlushingAudio == NONE && mFlushingVideo == NONE
+                    && (mAudioDecoder != NULL || mVideoDecoder != NULL)) {
+                inBufferSeek = (mSource->setParameter(KEY_DASH_SEEK_IN_BUFFER,
+                        &seekTimeUs, sizeof(seekTimeUs)) == OK);
+            }
+
+            if (inBufferSeek) {
+                ALOGV("seeking to %lld us within the buffered data", seekTimeUs);
+                nRet = OK;
+                if (mStats != NULL) {
+                    mStats->notifyInBufferSeek();
+                }
+            } else {
+                nRet = mSource->seekTo(seekTimeUs);
+            }
 
             if (mSourceType == kHttpLiveSource) {
                 mSource->getNewSeekTime(&newSeekTime);
@@ -907,15 +1007,20 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                   mSource->getMediaPresence(audPresence,vidPresence,textPresence);
                   mRenderer->setMediaPresence(true,audPresence); // audio
                   mRenderer->setMediaPresence(false,vidPresence); // video
+                  if (inBufferSeek) {
+                      // Pre-roll from the sync sample is decoded but not shown
+                      mSkipRenderingAudioUntilMediaTimeUs = seekTimeUs;
+                      mSkipRenderingVideoUntilMediaTimeUs = seekTimeUs;
+                  }
                   if( (mVideoDecoder != NULL) &&
                       (mFlushingVideo == NONE || mFlushingVideo == AWAITING_DISCONTINUITY) ) {
-                      flushDecoder( false, true ); // flush video, shutdown
+                      flushDecoder( false, !inBufferSeek, true ); // flush video, shutdown unless in-buffer
                   }
 
                  if( (mAudioDecoder != NULL) &&
                      (mFlushingAudio == NONE|| mFlushingAudio == AWAITING_DISCONTINUITY) )
                  {
-                     flushDecoder( true, true );  // flush audio,  shutdown
+                     flushDecoder( true, !inBufferSeek, true );  // flush audio, shutdown unless in-buffer
                  }
                  if( mAudioDecoder == NULL ) {
                      ALOGV("Audio is not there, set it to shutdown");
@@ -934,16 +1039,19 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                ALOGV("newSeekTime %lld", newSeekTime);
 
                mTimedTextCEASamplesDisc = true;
+               if (mTextRenderer != NULL) {
+                   mTextRenderer->flush(seekTimeUs);
+               }
             }
             if( (newSeekTime >= 0 ) && (mSourceType != kHttpDashSource)) {
                mTimeDiscontinuityPending = true;
                if( (mAudioDecoder != NULL) &&
                    (mFlushingAudio == NONE || mFlushingAudio == AWAITING_DISCONTINUITY) ) {
-                  flushDecoder( true, true );
+                  flushDecoder( true, true, true );
                }
                if( (mVideoDecoder != NULL) &&
                    (mFlushingVideo == NONE || mFlushingVideo == AWAITING_DISCONTINUITY) ) {
-                  flushDecoder( false, true );
+                  flushDecoder( false, true, true );
                }
                if( mAudioDecoder == NULL ) {
                    ALOGV("Audio is not there, set it to shutdown");
@@ -980,6 +1088,9 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
             ALOGE("kWhatPause");
             CHECK(mRenderer != NULL);
             mRenderer->pause();
+            if (mTextRenderer != NULL) {
+                mTextRenderer->pause();
+            }
 
             mPauseIndication = true;
 
@@ -1031,13 +1142,13 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                     mRenderer->setMediaPresence(false,vidPresence); // video
                     if( (mVideoDecoder != NULL) &&
                       (mFlushingVideo == NONE || mFlushingVideo == AWAITING_DISCONTINUITY) ) {
-                        flushDecoder( false, true ); // flush video, shutdown
+                        flushDecoder( false, true, true ); // flush video, shutdown
                     }
 
                     if( (mAudioDecoder != NULL) &&
                       (mFlushingAudio == NONE|| mFlushingAudio == AWAITING_DISCONTINUITY) )
                     {
-                      flushDecoder( true, true );  // flush audio,  shutdown
+                      flushDecoder( true, true, true );  // flush audio,  shutdown
                     }
                     if( mAudioDecoder == NULL ) {
                       ALOGV("Audio is not there, set it to shutdown");
@@ -1061,6 +1172,9 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                     }
 
                     mTimedTextCEASamplesDisc = true;
+                    if (mTextRenderer != NULL) {
+                      mTextRenderer->flush(seekTimeUs);
+                    }
                   }
                 }
               }
@@ -1100,6 +1214,9 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
 
             CHECK(mRenderer != NULL);
             mRenderer->resume();
+            if (mTextRenderer != NULL) {
+                mTextRenderer->resume();
+            }
 
             mPauseIndication = false;
 
@@ -1189,6 +1306,7 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                           {
                               mBufferingNotification = true;
                               notifyListener(MEDIA_INFO, MEDIA_INFO_BUFFERING_START, 0);
+                              mAbrController->onRebufferStart();
                           }
                       }
                       else {
@@ -1219,6 +1337,66 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
             }
             break;
        }
+       case kWhatPooledDecoderNotify:
+       {
+           // Only the end of an evicted decoder's shutdown, or an error
+           // from an idle one, are of interest here.
+           int32_t handlerId;
+           CHECK(msg->findInt32("handler-id", &handlerId));
+
+           sp<AMessage> codecRequest;
+           CHECK(msg->findMessage("codec-request", &codecRequest));
+
+           int32_t what;
+           CHECK(codecRequest->findInt32("what", &what));
+
+           if (what != DashCodec::kWhatShutdownCompleted
+                   && what != DashCodec::kWhatError) {
+               break;
+           }
+
+           for (int track = kVideo; track <= kAudio; ++track) {
+               PooledDecoder &entry = mDecoderPool[track];
+               if (entry.mDecoder != NULL && entry.mDecoder->id() == handlerId) {
+                   ALOGE("pooled decoder failed with %d, dropping it", what);
+                   looper()->unregisterHandler(handlerId);
+                   entry.mDecoder.clear();
+                   ++entry.mGeneration;
+               }
+
+               for (List<sp<Decoder> >::iterator it = mEvictedDecoders[track].begin();
+                    it != mEvictedDecoders[track].end(); ++it) {
+                   if ((*it)->id() == handlerId) {
+                       ALOGV("evicted decoder shut down");
+                       looper()->unregisterHandler(handlerId);
+                       mEvictedDecoders[track].erase(it);
+                       break;
+                   }
+               }
+           }
+
+           if (mResetAwaitingEviction
+                   && mEvictedDecoders[kVideo].empty()
+                   && mEvictedDecoders[kAudio].empty()) {
+               mResetAwaitingEviction = false;
+               notifyResetComplete();
+           }
+           break;
+       }
+
+       case kWhatEvictPooledDecoder:
+       {
+           int32_t track, generation;
+           CHECK(msg->findInt32("track", &track));
+           CHECK(msg->findInt32("generation", &generation));
+
+           if (generation == mDecoderPool[track].mGeneration) {
+               ALOGV("pooled decoder idle for %lld us", mDecoderPoolIdleUs);
+               evictPooledDecoder(track);
+           }
+           break;
+       }
+
        case kWhatQOE:
            {
                sp<AMessage> dataQOE;
@@ -1277,6 +1455,8 @@ void DashPlayer::onMessageReceived(const sp<AMessage> &msg) {
                    notifyDataQOE.writeInt32(bandwidth);
                    notifyDataQOE.writeInt32(reBufCount);
                    notifyDataQOE.writeInt64(timeofday);
+
+                   mAbrController->onThroughputSample(bandwidth);
                  }
                  notifyListener(MEDIA_QOE,kWhatQOE,what,&notifyDataQOE);
                }
@@ -1393,6 +1573,9 @@ void DashPlayer::finishReset() {
         mRenderer.clear();
     }
 
+    evictPooledDecoder(kAudio);
+    evictPooledDecoder(kVideo);
+
     if (mSource != NULL) {
         ALOGV("finishReset calling mSource->stop");
         mSource->stop();
@@ -1424,6 +1607,18 @@ void DashPlayer::finishReset() {
        mSourceNotify = NULL;
     }
 
+    if (!mEvictedDecoders[kVideo].empty() || !mEvictedDecoders[kAudio].empty()) {
+        // The hardware codec instances are only released once the
+        // shutdown of the evicted decoders completes
+        ALOGV("reset waits for the evicted decoders to shut down");
+        mResetAwaitingEviction = true;
+        return;
+    }
+
+    notifyResetComplete();
+}
+
+void DashPlayer::notifyResetComplete() {
     if (mDriver != NULL) {
         sp<DashPlayerDriver> driver = mDriver.promote();
         if (driver != NULL) {
@@ -1456,6 +1651,16 @@ status_t DashPlayer::instantiateDecoder(int track, sp<Decoder> *decoder) {
         return -EWOULDBLOCK;
     }
 
+    sp<Decoder> pooled;
+    if (track == kAudio || track == kVideo) {
+        if (!reclaimDecoder(track, meta, &pooled)
+                && !mEvictedDecoders[track].empty()) {
+            // scanSources keeps retrying while the track has no decoder
+            ALOGV("waiting for the evicted decoder to shut down");
+            return -EWOULDBLOCK;
+        }
+    }
+
     if (track == kVideo) {
         const char *mime;
         CHECK(meta->findCString(kKeyMIMEType, &mime));
@@ -1490,11 +1695,28 @@ status_t DashPlayer::instantiateDecoder(int track, sp<Decoder> *decoder) {
         }
     }
 
+    if (track == kVideo || track == kAudio) {
+        void *data = NULL;
+        size_t size = 0;
+        mSourceFillsInputBuffer[track] =
+            (mSource->getParameter(KEY_DASH_FILL_INPUT_BUFFER, &data, &size) == OK)
+            && (data != NULL) && (size == sizeof(int32_t))
+            && (*(int32_t *)data & (1 << track));
+    }
+
     sp<AMessage> notify;
+    bool reused = false;
     if (track == kAudio) {
         notify = new AMessage(kWhatAudioNotify ,id());
-        ALOGV("Creating Audio Decoder ");
-        *decoder = new Decoder(notify);
+        if (pooled != NULL) {
+            ALOGV("Reusing Audio Decoder ");
+            *decoder = pooled;
+            (*decoder)->setNotificationMessage(notify);
+            reused = true;
+        } else {
+            ALOGV("Creating Audio Decoder ");
+            *decoder = new Decoder(notify);
+        }
         ALOGV("@@@@:: setting Sink/Renderer pointer to decoder");
         (*decoder)->setSink(mAudioSink, mRenderer);
         if (mRenderer != NULL) {
@@ -1502,8 +1724,15 @@ status_t DashPlayer::instantiateDecoder(int track, sp<Decoder> *decoder) {
         }
     } else if (track == kVideo) {
         notify = new AMessage(kWhatVideoNotify ,id());
-        *decoder = new Decoder(notify, mNativeWindow);
-        ALOGV("Creating Video Decoder ");
+        if (pooled != NULL) {
+            ALOGV("Reusing Video Decoder ");
+            *decoder = pooled;
+            (*decoder)->setNotificationMessage(notify);
+            reused = true;
+        } else {
+            *decoder = new Decoder(notify, mNativeWindow);
+            ALOGV("Creating Video Decoder ");
+        }
         if (mRenderer != NULL) {
             mRenderer->setMediaPresence(false,true);
         }
@@ -1519,7 +1748,9 @@ status_t DashPlayer::instantiateDecoder(int track, sp<Decoder> *decoder) {
         }
     }
 
-    looper()->registerHandler(*decoder);
+    if (!reused) {
+        looper()->registerHandler(*decoder);
+    }
 
     char value[PROPERTY_VALUE_MAX] = {0};
     if (mSourceType == kHttpLiveSource || mSourceType == kHttpDashSource){
@@ -1533,7 +1764,13 @@ status_t DashPlayer::instantiateDecoder(int track, sp<Decoder> *decoder) {
         }
     }
 
-    if( track == kAudio || track == kVideo) {
+    if (track == kAudio || track == kVideo) {
+        mDecoderKey[track] = getDecoderPoolKey(track, meta);
+    }
+
+    if (reused) {
+        (*decoder)->reuse(meta);
+    } else if( track == kAudio || track == kVideo) {
         (*decoder)->configure(meta);
     }
 
@@ -1571,12 +1808,17 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
 
     sp<ABuffer> accessUnit;
 
+    // Let the source write straight into the decoder's input buffer
+    bool fillInputBuffer = (mIsSecureInputBuffers && track == kVideo)
+            || ((track == kAudio || track == kVideo)
+                    && mSourceFillsInputBuffer[track]);
+
     bool dropAccessUnit;
     do {
 
         status_t err = UNKNOWN_ERROR;
 
-        if (mIsSecureInputBuffers && track == kVideo) {
+        if (fillInputBuffer) {
             msg->findBuffer("buffer", &accessUnit);
 
             if (accessUnit == NULL) {
@@ -1639,7 +1881,7 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
                     mTimeDiscontinuityPending || timeChange;
 
                 if (formatChange || timeChange) {
-                    flushDecoder(track, formatChange);
+                    flushDecoder(track, formatChange, true /* poolDecoder */);
                 } else {
                     // This stream is unaffected by the discontinuity
 
@@ -1703,6 +1945,7 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
     if (track == kVideo || track == kAudio) {
         reply->setBuffer("buffer", accessUnit);
         reply->post();
+        sampleBufferedDuration(track);
     } else if (mSourceType == kHttpDashSource && track == kText) {
         sendTextPacket(accessUnit,OK);
         if (mSource != NULL) {
@@ -1712,6 +1955,34 @@ status_t DashPlayer::feedDecoderInputData(int track, const sp<AMessage> &msg) {
     return OK;
 }
 
+void DashPlayer::sampleBufferedDuration(int track) {
+    // The level of the video queue drives ABR, audio only without video
+    if (track != (mVideoDecoder != NULL ? kVideo : kAudio)) {
+        return;
+    }
+
+    if (!mSourceReportsBufferLevel) {
+        return;
+    }
+
+    int64_t nowUs = ALooper::GetNowUs();
+    if (mLastAbrSampleUs >= 0 && nowUs - mLastAbrSampleUs < kAbrSampleIntervalUs) {
+        return;
+    }
+    mLastAbrSampleUs = nowUs;
+
+    // Without a buffer level the controller stays on the throughput estimate
+    void *data = NULL;
+    size_t size = 0;
+    if (mSource->getParameter(KEY_DASH_BUFFERED_DURATION, &data, &size) != OK
+            || data == NULL || size != sizeof(int64_t)) {
+        ALOGV("source does not report its buffer level");
+        mSourceReportsBufferLevel = false;
+        return;
+    }
+    mAbrController->onBufferedDurationSample(*(int64_t *)data);
+}
+
 void DashPlayer::renderBuffer(bool audio, const sp<AMessage> &msg) {
     // ALOGV("renderBuffer %s", audio ? "audio" : "video");
 
@@ -1941,7 +2212,81 @@ void DashPlayer::notifyListener(int msg, int ext1, int ext2, const Parcel *obj)
         driver->notifyListener(msg, ext1, ext2, obj);
 }
 
-void DashPlayer::flushDecoder(bool audio, bool needShutdown) {
+// static
+AString DashPlayer::getDecoderPoolKey(int track, const sp<MetaData> &meta) {
+    const char *mime;
+    CHECK(meta->findCString(kKeyMIMEType, &mime));
+
+    // Decoder::configure() keys the codec setup on the presence of these
+    int32_t value;
+    bool secure = meta->findInt32(kKeyRequiresSecureBuffers, &value);
+    bool drm = meta->findInt32(kKeyIsDRM, &value);
+
+    // DashCodec reconfigures its ports on a size or rate change, only a
+    // video stream beyond the adaptive playback size needs a new decoder
+    bool large = false;
+    if (track == kVideo) {
+        int32_t width = 0, height = 0;
+        meta->findInt32(kKeyWidth, &width);
+        meta->findInt32(kKeyHeight, &height);
+        large = width > kAdaptiveMaxWidth || height > kAdaptiveMaxHeight;
+    }
+
+    return StringPrintf("%s/%d/%d/%d", mime, secure, drm, large);
+}
+
+void DashPlayer::parkDecoder(int track, const sp<Decoder> &decoder) {
+    evictPooledDecoder(track);
+
+    // Codec messages of the idle decoder must not be taken for the
+    // active one of the track
+    sp<AMessage> notify = new AMessage(kWhatPooledDecoderNotify, id());
+    notify->setInt32("handler-id", decoder->id());
+    decoder->setNotificationMessage(notify);
+
+    PooledDecoder &entry = mDecoderPool[track];
+    entry.mDecoder = decoder;
+    entry.mKey = mDecoderKey[track];
+    ++entry.mGeneration;
+
+    sp<AMessage> msg = new AMessage(kWhatEvictPooledDecoder, id());
+    msg->setInt32("track", track);
+    msg->setInt32("generation", entry.mGeneration);
+    msg->post(mDecoderPoolIdleUs);
+}
+
+bool DashPlayer::reclaimDecoder(
+        int track, const sp<MetaData> &meta, sp<Decoder> *decoder) {
+    PooledDecoder &entry = mDecoderPool[track];
+    if (entry.mDecoder == NULL) {
+        return false;
+    }
+
+    if (entry.mKey != getDecoderPoolKey(track, meta)) {
+        evictPooledDecoder(track);
+        return false;
+    }
+
+    *decoder = entry.mDecoder;
+    entry.mDecoder.clear();
+    ++entry.mGeneration;
+    return true;
+}
+
+void DashPlayer::evictPooledDecoder(int track) {
+    PooledDecoder &entry = mDecoderPool[track];
+    if (entry.mDecoder == NULL) {
+        return;
+    }
+
+    ALOGV("evicting pooled %s decoder", track == kAudio ? "audio" : "video");
+    entry.mDecoder->initiateShutdown();
+    mEvictedDecoders[track].push_back(entry.mDecoder);
+    entry.mDecoder.clear();
+    ++entry.mGeneration;
+}
+
+void DashPlayer::flushDecoder(bool audio, bool needShutdown, bool poolDecoder) {
     if ((audio && mAudioDecoder == NULL) || (!audio && mVideoDecoder == NULL)) {
         ALOGI("flushDecoder %s without decoder present",
              audio ? "audio" : "video");
@@ -1960,6 +2305,8 @@ void DashPlayer::flushDecoder(bool audio, bool needShutdown) {
     FlushStatus newStatus =
         needShutdown ? FLUSHING_DECODER_SHUTDOWN : FLUSHING_DECODER;
 
+    mPoolDecoderOnShutdown[audio ? kAudio : kVideo] = needShutdown && poolDecoder;
+
     if (audio) {
         CHECK(mFlushingAudio == NONE
                 || mFlushingAudio == AWAITING_DISCONTINUITY);
@@ -2080,6 +2427,18 @@ status_t DashPlayer::getParameter(int key, Parcel *reply)
          ALOGE("DashPlayer::getParameter KEY_DASH_REPOSITION_RANGE err in NOT OK");
        }
     }
+    else if (key == KEY_DASH_ABR_RECOMMENDATION)
+    {
+       DashPlayerAbrController::Recommendation rec;
+       mAbrController->getRecommendation(&rec);
+       reply->setDataPosition(0);
+       reply->writeInt32(rec.mPolicy);
+       reply->writeInt32(rec.mBandwidthBps);
+       reply->writeInt32(rec.mThroughputBps);
+       reply->writeInt64(rec.mBufferedUs);
+       reply->writeInt32(rec.mRebufferCount);
+       ALOGV("DashPlayer::getParameter KEY_DASH_ABR_RECOMMENDATION %d bps", rec.mBandwidthBps);
+    }
     else if(key == INVOKE_ID_GET_TRACK_INFO)
     {
       err = mSource->getTrackInfo(reply);
@@ -2105,6 +2464,7 @@ status_t DashPlayer::getParameter(int key, Parcel *reply)
           dataQOE->findInt64("timeofday",&timeofday);
           dataQOE->findInt32("bandwidth",&bandwidth);
           dataQOE->findInt32("sizeipadd",&ipaddSize);
+          mAbrController->onThroughputSample(bandwidth);
           dataQOE->findString("ipaddress",&ipAdd);
           dataQOE->findInt32("sizevideo",&videoSize);
           dataQOE->findString("videourl",&videoUrl);
@@ -2187,131 +2547,12 @@ void DashPlayer::postIsPrepareDone()
 }
 void DashPlayer::sendTextPacket(sp<ABuffer> accessUnit,status_t err, TimedTextType eTimedTextType)
 {
-    if(!mQCTimedTextListenerPresent)
-{
-      return;
-    }
-
-    Parcel parcel;
-    int mFrameType = TIMED_TEXT_FLAG_FRAME;
-
-    //Local setting
-    parcel.writeInt32(KEY_LOCAL_SETTING);
-
-    parcel.writeInt32(KEY_TEXT_FORMAT);
-    // UPDATE TIMEDTEXT SAMPLE TYPE
-    //Currently dash only support SMPTE-TT and CEA formats. No support for other timedtext types (like WebVTT, SRT)
-    if(eTimedTextType == TIMED_TEXT_SMPTE)
-    {
-      parcel.writeString16((String16)"smptett");
-    }
-    else if(eTimedTextType == TIMED_TEXT_CEA)
-    {
-      parcel.writeString16((String16)"cea");
-    }
-    else
-    {
-      parcel.writeString16((String16)"unknown");
-    }
-
-    // UPDATE TIMEDTEXT SAMPLE FLAGS
-    parcel.writeInt32(KEY_TEXT_FLAG_TYPE);
-    if (err == ERROR_END_OF_STREAM ||
-        err == (status_t)UNKNOWN_ERROR)
+    if(!mQCTimedTextListenerPresent || mTextRenderer == NULL)
     {
-       parcel.writeInt32(TIMED_TEXT_FLAG_EOS);
-       // write size of sample
-       ALOGE("sendTextPacket Error End Of Stream EOS");
-       mFrameType = TIMED_TEXT_FLAG_EOS;
-       notifyListener(MEDIA_TIMED_TEXT, 0, mFrameType, &parcel);
-       return;
-    }
-
-    int32_t tCodecConfig = 0;
-    accessUnit->meta()->findInt32("conf", &tCodecConfig);
-    if (tCodecConfig)
-    {
-       ALOGV("Timed text codec config frame");
-       parcel.writeInt32(TIMED_TEXT_FLAG_CODEC_CONFIG);
-       mFrameType = TIMED_TEXT_FLAG_CODEC_CONFIG;
-    }
-    else
-    {
-       parcel.writeInt32(TIMED_TEXT_FLAG_FRAME);
-       mFrameType = TIMED_TEXT_FLAG_FRAME;
-    }
-
-    int32_t bDisc = 0;
-    accessUnit->meta()->findInt32("disc", &bDisc);
-      if(bDisc == 1)
-      {
-        ALOGV("sendTextPacket signal discontinuity");
-        parcel.writeInt32(KEY_TEXT_DISCONTINUITY);
-      }
-
-    // UPDATE TIMEDTEXT SAMPLE TEXT DATA
-    parcel.writeInt32(KEY_STRUCT_TEXT);
-    // write size of sample
-    parcel.writeInt32((int32_t)accessUnit->size());
-    parcel.writeInt32((int32_t)accessUnit->size());
-    // write sample payload
-    parcel.write((const uint8_t *)accessUnit->data(), accessUnit->size());
-
-    // UPDATE TIMEDTEXT SAMPLE PROPERTIES
-    int64_t mediaTimeUs = 0;
-    CHECK(accessUnit->meta()->findInt64("timeUs", &mediaTimeUs));
-    parcel.writeInt32(KEY_START_TIME);
-    parcel.writeInt32((int32_t)(mediaTimeUs / 1000));  // convert micro sec to milli sec
-
-    ALOGV("sendTextPacket Text Track Timestamp (%0.2f) sec",mediaTimeUs / 1E6);
-
-    int32_t height = 0;
-    if (accessUnit->meta()->findInt32("height", &height)) {
-        ALOGV("sendTextPacket Height (%d)",height);
-        parcel.writeInt32(KEY_HEIGHT);
-        parcel.writeInt32(height);
-    }
-
-    // width
-    int32_t width = 0;
-    if (accessUnit->meta()->findInt32("width", &width)) {
-        ALOGE("sendTextPacket width (%d)",width);
-        parcel.writeInt32(KEY_WIDTH);
-        parcel.writeInt32(width);
-    }
-
-    // Duration
-    int32_t duration = 0;
-    if (accessUnit->meta()->findInt32("duration", &duration)) {
-        ALOGE("sendTextPacket duration (%d)",duration);
-        parcel.writeInt32(KEY_DURATION);
-        parcel.writeInt32(duration);
-    }
-
-    // start offset
-    int32_t startOffset = 0;
-    if (accessUnit->meta()->findInt32("startoffset", &startOffset)) {
-        ALOGE("sendTextPacket startOffset (%d)",startOffset);
-        parcel.writeInt32(KEY_START_OFFSET);
-        parcel.writeInt32(startOffset);
-    }
-
-    // SubInfoSize
-    int32_t subInfoSize = 0;
-    if (accessUnit->meta()->findInt32("subSz", &subInfoSize)) {
-        ALOGE("sendTextPacket subInfoSize (%d)",subInfoSize);
-    }
-
-    // SubInfo
-    AString subInfo;
-    if (accessUnit->meta()->findString("subSi", &subInfo)) {
-        parcel.writeInt32(KEY_SUB_ATOM);
-        parcel.writeInt32(subInfoSize);
-        parcel.writeInt32(subInfoSize);
-        parcel.write((const uint8_t *)subInfo.c_str(), subInfoSize);
+      return;
     }
 
-    notifyListener(MEDIA_TIMED_TEXT, 0, mFrameType, &parcel);
+    mTextRenderer->queueText(accessUnit, err, eTimedTextType);
 }
 
 void DashPlayer::getTrackName(int track, char* name)
@@ -2354,7 +2595,10 @@ void DashPlayer::prepareSource()
 
 status_t DashPlayer::dump(int fd, const Vector<String16> & /*args*/)
 {
+    mAbrController->dump(fd);
+
     if(mStats != NULL) {
+      mStats->dumpSyncStatistics(fd);
       mStats->setFileDescAndOutputStream(fd);
     }
 
@@ -2405,6 +2649,9 @@ void DashPlayer::processDeferredActions() {
 void DashPlayer::performSetSurface(const sp<NativeWindowWrapper> &wrapper) {
     ALOGV("performSetSurface");
 
+    // A pooled video decoder renders to the old window
+    evictPooledDecoder(kVideo);
+
     mNativeWindow = wrapper;
 
     // XXX - ignore error from setVideoScalingMode for now
@@ -22,7 +22,9 @@
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/NativeWindowWrapper.h>
 #include "DashPlayerStats.h"
+#include "DashPlayerAbrController.h"
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AString.h>
 #include <cutils/properties.h>
 
 #define KEY_QCTIMEDTEXT_LISTENER 6000
@@ -41,6 +43,21 @@
 
 //Key to query reposition range
 #define KEY_DASH_REPOSITION_RANGE    9000
+//Key to query the ABR controller's bandwidth recommendation
+#define KEY_DASH_ABR_RECOMMENDATION  9001
+//Key to ask the source which tracks it dequeues straight into the decoder
+//input buffer; the reply is an int32 mask of (1 << track). The vendor
+//source does not answer it yet, so decoders keep copying their input.
+#define KEY_DASH_FILL_INPUT_BUFFER   9002
+//Key to ask the source for the media time it has queued ahead of the
+//decoder, for video or for audio when there is no video; int64 in us.
+//The vendor source does not answer it yet, so ABR runs on throughput only.
+#define KEY_DASH_BUFFERED_DURATION   9003
+//Key to ask the source to seek inside its queued data, starting each track
+//at the last sync sample at or before the int64 target in us. The source
+//fails without touching its queues if any track cannot do so. The vendor
+//source does not handle it yet, so seeks keep the full seekTo() path.
+#define KEY_DASH_SEEK_IN_BUFFER      9004
 
 namespace android {
 
@@ -103,6 +120,7 @@ protected:
 private:
     struct Decoder;
     struct Renderer;
+    struct TextRenderer;
     struct Source;
     struct Action;
     struct SimpleAction;
@@ -163,6 +181,8 @@ private:
         kWhatPrepareAsync               = 'pras',
         kWhatIsPrepareDone              = 'prdn',
         kWhatSourceNotify               = 'snfy',
+        kWhatPooledDecoderNotify        = 'pdcN',
+        kWhatEvictPooledDecoder         = 'evpD',
         kKeySmoothStreaming             = 'ESmS',  //bool (int32_t)
         kKeyEnableDecodeOrder           = 'EDeO',  //bool (int32_t)
     };
@@ -234,11 +254,17 @@ private:
     FlushStatus mFlushingVideo;
     bool mResetInProgress;
     bool mResetPostponed;
+    bool mResetAwaitingEviction;
     bool mSetVideoSize;
 
     int64_t mSkipRenderingAudioUntilMediaTimeUs;
     int64_t mSkipRenderingVideoUntilMediaTimeUs;
 
+    // Seek inside buffered data with a decoder flush instead of a
+    // source seek and decoder shutdown, for sources that take
+    // KEY_DASH_SEEK_IN_BUFFER
+    bool mInBufferSeekEnabled;
+
     int64_t mVideoLateByUs;
     int64_t mNumFramesTotal, mNumFramesDropped;
 
@@ -263,6 +289,7 @@ private:
     NuSourceType mSourceType;
 
     bool mIsSecureInputBuffers;
+    bool mSourceFillsInputBuffer[2];  // kVideo, kAudio
 
     int32_t mSRid;
 
@@ -275,11 +302,37 @@ private:
 
     void finishFlushIfPossible();
 
-    void flushDecoder(bool audio, bool needShutdown);
+    void flushDecoder(bool audio, bool needShutdown, bool poolDecoder = false);
+
+    // A decoder whose shutdown was requested for a seek or a format change
+    // is kept flushed and configured, at most one per track, and taken
+    // back by instantiateDecoder if the next stream needs the same codec:
+    // same mime, secure and DRM setup, and for video the same side of the
+    // adaptive playback size. Otherwise it is shut down after
+    // mDecoderPoolIdleUs, and at the latest by finishReset.
+    struct PooledDecoder {
+        sp<Decoder> mDecoder;
+        AString mKey;
+        int32_t mGeneration;        // drops stale idle evictions
+    };
+    PooledDecoder mDecoderPool[2];  // kVideo, kAudio
+    AString mDecoderKey[2];         // format of the active decoders
+    bool mPoolDecoderOnShutdown[2];
+    int64_t mDecoderPoolIdleUs;
+    // Evicted decoders, kept alive until their shutdown completes. No new
+    // decoder of the track is configured before then, the hardware codec
+    // instances and the native window are not shared.
+    List<sp<Decoder> > mEvictedDecoders[2];
+
+    static AString getDecoderPoolKey(int track, const sp<MetaData> &meta);
+    void parkDecoder(int track, const sp<Decoder> &decoder);
+    bool reclaimDecoder(int track, const sp<MetaData> &meta, sp<Decoder> *decoder);
+    void evictPooledDecoder(int track);
 
     static bool IsFlushingState(FlushStatus state, bool *needShutdown = NULL);
 
     void finishReset();
+    void notifyResetComplete();
     void postScanSources();
 
     sp<Source> LoadCreateSource(const char * uri, const KeyedVector<String8,
@@ -290,6 +343,16 @@ private:
     // for qualcomm statistics profiling
     sp<DashPlayerStats> mStats;
 
+    sp<DashPlayerAbrController> mAbrController;
+    int64_t mLastAbrSampleUs;
+    // Cleared once the source turns down KEY_DASH_BUFFERED_DURATION
+    bool mSourceReportsBufferLevel;
+    void sampleBufferedDuration(int track);
+
+    // Timed text is turned into parcels and delivered on its own looper
+    sp<ALooper> mTextLooper;
+    sp<TextRenderer> mTextRenderer;
+
     void sendTextPacket(sp<ABuffer> accessUnit, status_t err, DashPlayer::TimedTextType eTimedTextType = TIMED_TEXT_SMPTE);
     void getTrackName(int track, char* name);
     void prepareSource();
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "DashPlayerAbrController"
+#include <utils/Log.h>
+#include <utils/String8.h>
+#include <cutils/properties.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "DashPlayerAbrController.h"
+
+namespace android {
+
+// Share of the measured throughput the throughput policy is willing to use
+static const int32_t kThroughputSafetyPercent = 85;
+
+static int64_t getPropertyInt64(const char *key, int64_t defaultValue) {
+    char value[PROPERTY_VALUE_MAX];
+    if (property_get(key, value, NULL) > 0) {
+        return atoll(value);
+    }
+    return defaultValue;
+}
+
+// Rate follows the buffer level: minimum inside the reservoir, maximum
+// above reservoir + cushion and linear in between. Until the source reports
+// a buffer level the throughput estimate is used instead.
+struct DashPlayerAbrController::BufferBasedPolicy
+    : public DashPlayerAbrController::Policy {
+    virtual const char *name() const {
+        return "buffer";
+    }
+
+    virtual int32_t selectBandwidth(const State &state) const {
+        if (state.mBufferedUs < 0) {
+            return selectFromThroughput(state);
+        }
+
+        if (state.mBufferedUs <= state.mReservoirUs) {
+            return state.mMinBps;
+        }
+
+        int64_t aboveUs = state.mBufferedUs - state.mReservoirUs;
+        if (aboveUs >= state.mCushionUs) {
+            return state.mMaxBps;
+        }
+
+        return state.mMinBps + (int32_t)(
+                (int64_t)(state.mMaxBps - state.mMinBps) * aboveUs / state.mCushionUs);
+    }
+};
+
+// Rate follows the measured throughput, and drops to the minimum once the
+// buffer has drained into the reservoir to avoid a stall.
+struct DashPlayerAbrController::ThroughputPolicy
+    : public DashPlayerAbrController::Policy {
+    virtual const char *name() const {
+        return "throughput";
+    }
+
+    virtual int32_t selectBandwidth(const State &state) const {
+        if (state.mBufferedUs >= 0
+                && state.mBufferedUs < state.mReservoirUs / 2) {
+            return state.mMinBps;
+        }
+
+        return selectFromThroughput(state);
+    }
+};
+
+// Share of the throughput estimate, within the configured bounds
+int32_t DashPlayerAbrController::selectFromThroughput(const State &state) {
+    if (state.mThroughputBps == 0) {
+        return state.mMinBps;
+    }
+
+    int64_t bps = (int64_t)state.mThroughputBps * kThroughputSafetyPercent / 100;
+    if (bps < state.mMinBps) {
+        return state.mMinBps;
+    }
+    if (bps > state.mMaxBps) {
+        return state.mMaxBps;
+    }
+    return (int32_t)bps;
+}
+
+DashPlayerAbrController::DashPlayerAbrController()
+    : mPolicyType(kPolicyBufferBased),
+      mPolicy(NULL),
+      mNumSamples(0),
+      mRebufferCount(0),
+      mNumSwitches(0),
+      mLastBandwidthBps(0) {
+    mState.mThroughputBps = 0;
+    mState.mBufferedUs = -1;
+    mState.mMinBps = (int32_t)getPropertyInt64("persist.dash.abr.min.kbps", 200) * 1000;
+    mState.mMaxBps = (int32_t)getPropertyInt64("persist.dash.abr.max.kbps", 8000) * 1000;
+    mState.mReservoirUs = getPropertyInt64("persist.dash.abr.reservoir.ms", 5000) * 1000;
+    mState.mCushionUs = getPropertyInt64("persist.dash.abr.cushion.ms", 20000) * 1000;
+
+    if (mState.mMaxBps < mState.mMinBps) {
+        mState.mMaxBps = mState.mMinBps;
+    }
+    if (mState.mCushionUs <= 0) {
+        mState.mCushionUs = 1;
+    }
+
+    memset(mSamples, 0, sizeof(mSamples));
+
+    setPolicy((PolicyType)getPropertyInt64(
+            "persist.dash.abr.policy", kPolicyBufferBased));
+}
+
+DashPlayerAbrController::~DashPlayerAbrController() {
+    delete mPolicy;
+    mPolicy = NULL;
+}
+
+void DashPlayerAbrController::setPolicy(PolicyType type) {
+    Policy *policy;
+    if (type == kPolicyThroughput) {
+        policy = new ThroughputPolicy;
+    } else {
+        type = kPolicyBufferBased;
+        policy = new BufferBasedPolicy;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    delete mPolicy;
+    mPolicy = policy;
+    mPolicyType = type;
+    ALOGV("ABR policy %s", mPolicy->name());
+    update_l();
+}
+
+void DashPlayerAbrController::onThroughputSample(int32_t bandwidthBps) {
+    if (bandwidthBps <= 0) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mLock);
+    mSamples[mNumSamples % kThroughputWindow] = bandwidthBps;
+    ++mNumSamples;
+    mState.mThroughputBps = estimateThroughput_l();
+    update_l();
+}
+
+void DashPlayerAbrController::onBufferedDurationSample(int64_t bufferedUs) {
+    Mutex::Autolock autoLock(mLock);
+    mState.mBufferedUs = bufferedUs;
+    update_l();
+}
+
+void DashPlayerAbrController::onRebufferStart() {
+    Mutex::Autolock autoLock(mLock);
+    ++mRebufferCount;
+    // An unknown level stays unknown, nothing would raise it again
+    if (mState.mBufferedUs >= 0) {
+        mState.mBufferedUs = 0;
+    }
+    update_l();
+}
+
+void DashPlayerAbrController::getRecommendation(Recommendation *rec) {
+    Mutex::Autolock autoLock(mLock);
+    rec->mPolicy = mPolicyType;
+    rec->mBandwidthBps = mLastBandwidthBps;
+    rec->mThroughputBps = mState.mThroughputBps;
+    rec->mBufferedUs = mState.mBufferedUs;
+    rec->mRebufferCount = mRebufferCount;
+}
+
+void DashPlayerAbrController::dump(int fd) {
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+
+    Mutex::Autolock autoLock(mLock);
+
+    snprintf(buffer, SIZE, "abr policy %s: recommended %d kbps, throughput %d kbps\n",
+            mPolicy->name(), mLastBandwidthBps / 1000, mState.mThroughputBps / 1000);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "  buffered %lld ms, rebuffers %d, switches %d\n",
+            mState.mBufferedUs / 1000, mRebufferCount, mNumSwitches);
+    result.append(buffer);
+
+    write(fd, result.string(), result.size());
+}
+
+// Harmonic mean of the sample window, which keeps a single fast segment
+// from pulling the estimate up.
+int32_t DashPlayerAbrController::estimateThroughput_l() const {
+    uint32_t count = mNumSamples < kThroughputWindow ? mNumSamples : kThroughputWindow;
+    double sumInverse = 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        sumInverse += 1.0 / mSamples[i];
+    }
+
+    return count > 0 ? (int32_t)(count / sumInverse) : 0;
+}
+
+void DashPlayerAbrController::update_l() {
+    int32_t bandwidthBps = mPolicy->selectBandwidth(mState);
+
+    if (bandwidthBps != mLastBandwidthBps) {
+        ALOGV("ABR %s: %d -> %d bps (throughput %d, buffered %lld us)",
+                mPolicy->name(), mLastBandwidthBps, bandwidthBps,
+                mState.mThroughputBps, mState.mBufferedUs);
+        if (mLastBandwidthBps != 0) {
+            ++mNumSwitches;
+        }
+        mLastBandwidthBps = bandwidthBps;
+    }
+}
+
+} // namespace android
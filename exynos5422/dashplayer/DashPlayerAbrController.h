@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DASHPLAYER_ABR_CONTROLLER_H_
+
+#define DASHPLAYER_ABR_CONTROLLER_H_
+
+#include <utils/RefBase.h>
+#include <utils/threads.h>
+
+namespace android {
+
+// Keeps a model of network throughput and buffer level and turns it into
+// a bandwidth cap for the next representation switch. The representation
+// ladder itself is owned by the source, so the controller only recommends
+// a rate; the application reads it through KEY_DASH_ABR_RECOMMENDATION.
+class DashPlayerAbrController : public RefBase {
+  public:
+    enum PolicyType {
+        kPolicyBufferBased = 0,
+        kPolicyThroughput  = 1,
+    };
+
+    struct Recommendation {
+        int32_t mPolicy;
+        int32_t mBandwidthBps;
+        int32_t mThroughputBps;
+        int64_t mBufferedUs;
+        int32_t mRebufferCount;
+    };
+
+    DashPlayerAbrController();
+
+    void setPolicy(PolicyType type);
+
+    // Measured download rate, e.g. from a QOE switch or periodic event
+    void onThroughputSample(int32_t bandwidthBps);
+    void onBufferedDurationSample(int64_t bufferedUs);
+    void onRebufferStart();
+
+    void getRecommendation(Recommendation *rec);
+    void dump(int fd);
+
+  protected:
+    virtual ~DashPlayerAbrController();
+
+  private:
+    enum {
+        kThroughputWindow = 8,
+    };
+
+    struct State {
+        int32_t mThroughputBps;     // 0 until the first sample
+        int64_t mBufferedUs;        // -1 until the first sample
+        int32_t mMinBps;
+        int32_t mMaxBps;
+        int64_t mReservoirUs;
+        int64_t mCushionUs;
+    };
+
+    struct Policy {
+        virtual ~Policy() {}
+        virtual const char *name() const = 0;
+        virtual int32_t selectBandwidth(const State &state) const = 0;
+    };
+
+    struct BufferBasedPolicy;
+    struct ThroughputPolicy;
+
+    static int32_t selectFromThroughput(const State &state);
+
+    int32_t estimateThroughput_l() const;
+    void update_l();
+
+    Mutex mLock;
+    State mState;
+    PolicyType mPolicyType;
+    Policy *mPolicy;
+
+    // Last kThroughputWindow samples, mNumSamples wraps around the window
+    int32_t mSamples[kThroughputWindow];
+    uint32_t mNumSamples;
+
+    int32_t mRebufferCount;
+    int32_t mNumSwitches;
+    int32_t mLastBandwidthBps;
+};
+
+} // namespace android
+
+#endif // DASHPLAYER_ABR_CONTROLLER_H_
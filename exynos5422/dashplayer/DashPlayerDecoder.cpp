@@ -103,6 +103,19 @@ void DashPlayer::Decoder::configure(const sp<MetaData> &meta) {
 
 }
 
+void DashPlayer::Decoder::reuse(const sp<MetaData> &meta) {
+    CHECK(mCodec != NULL);
+
+    mCSD.clear();
+    makeFormat(meta);
+
+    mCodec->signalResume();
+}
+
+void DashPlayer::Decoder::setNotificationMessage(const sp<AMessage> &notify) {
+    mNotify = notify;
+}
+
 void DashPlayer::Decoder::onMessageReceived(const sp<AMessage> &msg) {
     switch (msg->what()) {
         case kWhatCodecNotify:
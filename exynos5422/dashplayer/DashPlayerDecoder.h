@@ -32,6 +32,13 @@ struct DashPlayer::Decoder : public AHandler {
 
     void configure(const sp<MetaData> &meta);
 
+    // Takes a flushed, configured decoder back into use for a stream with
+    // the same format: the codec config of meta is queued again ahead of
+    // the data and the codec is resumed.
+    void reuse(const sp<MetaData> &meta);
+
+    void setNotificationMessage(const sp<AMessage> &notify);
+
     void signalFlush();
     void signalResume();
     void initiateShutdown();
@@ -339,6 +339,11 @@ status_t DashPlayerDriver::invoke(const Parcel &request, Parcel *reply) {
            ret = getParameter(methodId,reply);
            break;
 
+       case KEY_DASH_ABR_RECOMMENDATION:
+           ALOGV("calling KEY_DASH_ABR_RECOMMENDATION");
+           ret = getParameter(methodId,reply);
+           break;
+
        case KEY_DASH_SEEK_EVENT:
        {
           ALOGV("calling KEY_DASH_SEEK_EVENT seekTo()");
@@ -24,12 +24,60 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <cutils/properties.h>
+#include <gui/ISurfaceComposer.h>
+#include <gui/SurfaceComposerClient.h>
+#include <ui/DisplayInfo.h>
 
 namespace android {
 
 // static
 const int64_t DashPlayer::Renderer::kMinPositionUpdateDelayUs = 100000ll;
 
+DashPlayer::Renderer::DisplayVsyncSource::DisplayVsyncSource()
+    : mPeriodUs(0),
+      mLastVsyncUs(-1ll),
+      mVsyncRequested(false) {
+    DisplayInfo info;
+    sp<IBinder> display = SurfaceComposerClient::getBuiltInDisplay(
+            ISurfaceComposer::eDisplayIdMain);
+    if (display != NULL
+            && SurfaceComposerClient::getDisplayInfo(display, &info) == OK
+            && info.fps > 0) {
+        mPeriodUs = (int64_t)(1E6 / info.fps);
+    }
+}
+
+status_t DashPlayer::Renderer::DisplayVsyncSource::initCheck() const {
+    if (mPeriodUs <= 0) {
+        return NO_INIT;
+    }
+    return mReceiver.initCheck();
+}
+
+void DashPlayer::Renderer::DisplayVsyncSource::getVsyncTiming(
+        int64_t *vsyncTimeUs, int64_t *periodUs) {
+    DisplayEventReceiver::Event events[8];
+    ssize_t n;
+    while ((n = mReceiver.getEvents(events, 8)) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            if (events[i].header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+                // Same monotonic clock as ALooper::GetNowUs()
+                mLastVsyncUs = events[i].header.timestamp / 1000ll;
+                mVsyncRequested = false;
+            }
+        }
+    }
+
+    // The next event refreshes the phase, one request at a time
+    if (!mVsyncRequested) {
+        mReceiver.requestNextVsync();
+        mVsyncRequested = true;
+    }
+
+    *vsyncTimeUs = mLastVsyncUs;
+    *periodUs = mLastVsyncUs >= 0 ? mPeriodUs : 0;
+}
+
 DashPlayer::Renderer::Renderer(
         const sp<MediaPlayerBase::AudioSink> &sink,
         const sp<AMessage> &notify)
@@ -68,6 +116,19 @@ DashPlayer::Renderer::Renderer(
       }
 
       ALOGV("AVsync window in Us %lld", mAVSyncDelayWindowUs);
+
+      // Frames are only placed on vsync slots the display actually has,
+      // persist.dash.vsync.align=0 turns this off
+      char vsyncAlign[PROPERTY_VALUE_MAX] = {0};
+      if (property_get("persist.dash.vsync.align", vsyncAlign, "1") > 0
+              && atoi(vsyncAlign) > 0) {
+          sp<DisplayVsyncSource> source = new DisplayVsyncSource;
+          if (source->initCheck() == OK) {
+              mVsyncSource = source;
+          } else {
+              ALOGW("display vsync unavailable, rendering at media time");
+          }
+      }
 }
 
 DashPlayer::Renderer::~Renderer() {
@@ -323,6 +384,11 @@ bool DashPlayer::Renderer::onDrainAudioQueue() {
 
             mAnchorTimeRealUs =
                 ALooper::GetNowUs() + realTimeOffsetUs;
+
+            if (mStats != NULL) {
+                mStats->recordAudioAnchor(
+                        mAnchorTimeMediaUs, mAnchorTimeRealUs, realTimeOffsetUs);
+            }
         }
 
         size_t copy = entry->mBuffer->size() - entry->mOffset;
@@ -393,7 +459,12 @@ void DashPlayer::Renderer::postDrainVideoQueue() {
             int64_t realTimeUs =
                 (mediaTimeUs - mAnchorTimeMediaUs) + mAnchorTimeRealUs;
 
-            delayUs = realTimeUs - ALooper::GetNowUs();
+            // Wake up half a refresh ahead of the vsync that is to show
+            // the frame, so it is queued to the display in time.
+            int64_t periodUs;
+            realTimeUs = getVsyncSlotUs(realTimeUs, &periodUs);
+
+            delayUs = realTimeUs - periodUs / 2 - ALooper::GetNowUs();
         }
     }
 
@@ -444,10 +515,21 @@ void DashPlayer::Renderer::onDrainVideoQueue() {
         if(mStats != NULL) {
             mStats->recordOnTime(realTimeUs,nowUs,mVideoLateByUs);
             mStats->incrementTotalRenderingFrames();
+            mStats->recordSeekFirstFrame();
             mStats->logFps();
         }
     }
 
+    if (!tooLate) {
+        // Lets the display present the frame at its vsync slot, once the
+        // display's vsync timing is known
+        int64_t periodUs;
+        int64_t slotUs = getVsyncSlotUs(realTimeUs, &periodUs);
+        if (periodUs > 0) {
+            entry->mNotifyConsumed->setInt64("timestampNs", slotUs * 1000ll);
+        }
+    }
+
     entry->mNotifyConsumed->setInt32("render", !tooLate);
     entry->mNotifyConsumed->post();
     mVideoQueue.erase(mVideoQueue.begin());
@@ -456,6 +538,37 @@ void DashPlayer::Renderer::onDrainVideoQueue() {
     notifyPosition();
 }
 
+int64_t DashPlayer::Renderer::getVsyncSlotUs(
+        int64_t realTimeUs, int64_t *periodUs) {
+    int64_t vsyncTimeUs = 0;
+    int64_t vsyncPeriodUs = 0;
+
+    if (mVsyncSource != NULL) {
+        mVsyncSource->getVsyncTiming(&vsyncTimeUs, &vsyncPeriodUs);
+    }
+
+    if (periodUs != NULL) {
+        *periodUs = vsyncPeriodUs > 0 ? vsyncPeriodUs : 0;
+    }
+
+    if (vsyncPeriodUs <= 0) {
+        return realTimeUs;
+    }
+
+    // Nearest vsync, earlier or later
+    int64_t phaseUs = (realTimeUs - vsyncTimeUs) % vsyncPeriodUs;
+    if (phaseUs < 0) {
+        phaseUs += vsyncPeriodUs;
+    }
+
+    int64_t slotUs = realTimeUs - phaseUs;
+    if (phaseUs * 2 >= vsyncPeriodUs) {
+        slotUs += vsyncPeriodUs;
+    }
+
+    return slotUs;
+}
+
 void DashPlayer::Renderer::notifyEOS(bool audio, status_t finalResult) {
     sp<AMessage> notify = mNotify->dup();
     notify->setInt32("what", kWhatEOS);
@@ -20,6 +20,8 @@
 
 #include "DashPlayer.h"
 
+#include <gui/DisplayEventReceiver.h>
+
 namespace android {
 
 struct ABuffer;
@@ -28,6 +30,33 @@ struct DashPlayer::Renderer : public AHandler {
     Renderer(const sp<MediaPlayerBase::AudioSink> &sink,
              const sp<AMessage> &notify);
 
+    // Display refresh timing used to place video frames on vsync slots.
+    struct VsyncSource : public RefBase {
+        // Returns the time of some past vsync and the refresh period, on
+        // the ALooper::GetNowUs() clock.
+        virtual void getVsyncTiming(int64_t *vsyncTimeUs, int64_t *periodUs) = 0;
+
+    protected:
+        virtual ~VsyncSource() {}
+    };
+
+    // Vsyncs of the built-in display as reported by SurfaceFlinger. Events
+    // are requested one at a time and read without blocking whenever the
+    // timing is asked for, the refresh period comes from the display info.
+    struct DisplayVsyncSource : public VsyncSource {
+        DisplayVsyncSource();
+
+        status_t initCheck() const;
+
+        virtual void getVsyncTiming(int64_t *vsyncTimeUs, int64_t *periodUs);
+
+    private:
+        DisplayEventReceiver mReceiver;
+        int64_t mPeriodUs;
+        int64_t mLastVsyncUs;   // -1 until the first event
+        bool mVsyncRequested;
+    };
+
     void queueBuffer(
             bool audio,
             const sp<ABuffer> &buffer,
@@ -122,11 +151,14 @@ private:
     int64_t mVideoLateByUs;
     int64_t mAVSyncDelayWindowUs;
 
+    sp<VsyncSource> mVsyncSource;
+
     bool onDrainAudioQueue();
     void postDrainAudioQueue(int64_t delayUs = 0);
 
     void onDrainVideoQueue();
     void postDrainVideoQueue();
+    int64_t getVsyncSlotUs(int64_t realTimeUs, int64_t *periodUs = NULL);
 #ifdef QCOM_WFD_SINK
     virtual void onQueueBuffer(const sp<AMessage> &msg);
 #else
@@ -28,12 +28,52 @@
  */
 
 #include <utils/Log.h>
+#include <utils/String8.h>
+#include <cutils/atomic.h>
 #include "DashPlayerStats.h"
 
 #define NO_MIMETYPE_AVAILABLE "N/A"
 
 namespace android {
 
+// Positive lateness is video behind the clock
+static const int64_t kVideoLatenessLimitsUs[] = {
+    -40000, -20000, -10000, -5000, 0, 5000, 10000, 20000, 40000, 80000, 160000,
+};
+
+static const int64_t kAudioLatencyLimitsUs[] = {
+    10000, 20000, 40000, 60000, 80000, 100000, 150000, 200000, 300000,
+};
+
+// Change of the audio anchor against the previous one
+static const int64_t kAnchorDriftLimitsUs[] = {
+    -20000, -10000, -5000, -2000, -1000, 1000, 2000, 5000, 10000, 20000,
+};
+
+static const int64_t kSeekLatencyLimitsUs[] = {
+    50000, 100000, 200000, 300000, 500000, 750000, 1000000, 1500000, 2000000, 3000000,
+};
+
+#ifndef NELEM
+#define NELEM(x) (sizeof(x) / sizeof((x)[0]))
+#endif
+
+void DashPlayerStats::Histogram::init(
+        const char *name, const int64_t *limitsUs, size_t numLimits) {
+    mName = name;
+    mLimitsUs = limitsUs;
+    mNumLimits = numLimits < kMaxHistogramBuckets ? numLimits : kMaxHistogramBuckets - 1;
+    memset((void *)mCounts, 0, sizeof(mCounts));
+}
+
+void DashPlayerStats::Histogram::add(int64_t valueUs) {
+    size_t i = 0;
+    while (i < mNumLimits && valueUs >= mLimitsUs[i]) {
+        ++i;
+    }
+    android_atomic_inc(&mCounts[i]);
+}
+
 DashPlayerStats::DashPlayerStats() {
       Mutex::Autolock autoLock(mStatsLock);
       mMIME = new char[strlen(NO_MIMETYPE_AVAILABLE)+1];
@@ -60,6 +100,17 @@ DashPlayerStats::DashPlayerStats() {
       mBufferingEvent = false;
       mFd = -1;
       mFileOut = NULL;
+      mVideoLateness.init("video lateness", kVideoLatenessLimitsUs, NELEM(kVideoLatenessLimitsUs));
+      mAudioLatency.init("audio sink latency", kAudioLatencyLimitsUs, NELEM(kAudioLatencyLimitsUs));
+      mAnchorDrift.init("anchor drift", kAnchorDriftLimitsUs, NELEM(kAnchorDriftLimitsUs));
+      mFullSeekLatency.init("full seek latency", kSeekLatencyLimitsUs, NELEM(kSeekLatencyLimitsUs));
+      mInBufferSeekLatency.init("in-buffer seek latency", kSeekLatencyLimitsUs, NELEM(kSeekLatencyLimitsUs));
+      mSeekLatencyPending = false;
+      mSeekInBuffer = false;
+      mLastAnchorOffsetUs = 0;
+      mHasAnchorOffset = false;
+      memset(mTrace, 0, sizeof(mTrace));
+      mTraceCount = 0;
 }
 
 DashPlayerStats::~DashPlayerStats() {
@@ -107,6 +158,30 @@ void DashPlayerStats::notifySeek() {
     Mutex::Autolock autoLock(mStatsLock);
     mFirstFrameLatencyStartUs = getTimeOfDayUs();
     mSeekPerformed = true;
+    mSeekInBuffer = false;
+    mSeekLatencyPending = true;
+}
+
+void DashPlayerStats::notifyInBufferSeek() {
+    Mutex::Autolock autoLock(mStatsLock);
+    mSeekInBuffer = true;
+}
+
+// Called for every rendered video frame, only the first after a seek counts
+void DashPlayerStats::recordSeekFirstFrame() {
+    if (!mSeekLatencyPending) {
+        return;
+    }
+
+    Mutex::Autolock autoLock(mStatsLock);
+    if (!mSeekLatencyPending) {
+        return;
+    }
+    mSeekLatencyPending = false;
+
+    int64_t latencyUs = getTimeOfDayUs() - mFirstFrameLatencyStartUs;
+    (mSeekInBuffer ? mInBufferSeekLatency : mFullSeekLatency).add(latencyUs);
+    addTrace(kTraceSeekLatency, latencyUs);
 }
 
 void DashPlayerStats::notifyBufferingEvent() {
@@ -115,18 +190,15 @@ void DashPlayerStats::notifyBufferingEvent() {
 }
 
 void DashPlayerStats::incrementTotalFrames() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mTotalFrames++;
+    __sync_fetch_and_add(&mTotalFrames, 1);
 }
 
 void DashPlayerStats::incrementTotalRenderingFrames() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mTotalRenderingFrames++;
+    __sync_fetch_and_add(&mTotalRenderingFrames, 1);
 }
 
 void DashPlayerStats::incrementDroppedFrames() {
-    Mutex::Autolock autoLock(mStatsLock);
-    mNumVideoFramesDropped++;
+    __sync_fetch_and_add(&mNumVideoFramesDropped, 1);
 }
 
 void DashPlayerStats::logStatistics() {
@@ -161,9 +233,15 @@ void DashPlayerStats::logSeek(int64_t seekTimeUs) {
     }
 }
 
+// Called from the renderer thread only, which is the only writer of the
+// catch-up and sync loss fields, so no lock is taken per frame.
+// mNumVideoFramesDropped is also bumped by the player looper and shares
+// its atomic add.
 void DashPlayerStats::recordLate(int64_t ts, int64_t clock, int64_t delta, int64_t anchorTime) {
-    Mutex::Autolock autoLock(mStatsLock);
-    mNumVideoFramesDropped++;
+    mVideoLateness.add(delta);
+    addTrace(kTraceVideoLateness, delta);
+
+    __sync_fetch_and_add(&mNumVideoFramesDropped, 1);
     mConsecutiveFramesDropped++;
     if (mConsecutiveFramesDropped == 1){
       mCatchupTimeStart = anchorTime;
@@ -172,8 +250,11 @@ void DashPlayerStats::recordLate(int64_t ts, int64_t clock, int64_t delta, int64
     logLate(ts,clock,delta);
 }
 
+// Called from the renderer thread only
 void DashPlayerStats::recordOnTime(int64_t ts, int64_t clock, int64_t delta) {
-    Mutex::Autolock autoLock(mStatsLock);
+    mVideoLateness.add(delta);
+    addTrace(kTraceVideoLateness, delta);
+
     mNumVideoFramesDecoded++;
     mConsecutiveFramesDropped = 0;
     logOnTime(ts,clock,delta);
@@ -244,13 +325,89 @@ void DashPlayerStats::logFpsSummary() {
     }
 }
 
+// Called from the renderer thread only
+void DashPlayerStats::recordAudioAnchor(
+        int64_t mediaTimeUs, int64_t realTimeUs, int64_t sinkLatencyUs) {
+    mAudioLatency.add(sinkLatencyUs);
+    addTrace(kTraceAudioLatency, sinkLatencyUs);
+
+    int64_t offsetUs = realTimeUs - mediaTimeUs;
+    if (mHasAnchorOffset) {
+        int64_t driftUs = offsetUs - mLastAnchorOffsetUs;
+        mAnchorDrift.add(driftUs);
+        addTrace(kTraceAnchorDrift, driftUs);
+    }
+    mLastAnchorOffsetUs = offsetUs;
+    mHasAnchorOffset = true;
+}
+
+void DashPlayerStats::addTrace(TraceEvent event, int64_t valueUs) {
+    int32_t index = android_atomic_inc(&mTraceCount);
+    TraceRecord &record = mTrace[(uint32_t)index % kTraceSize];
+
+    record.mTimeUs = getTimeOfDayUs();
+    record.mEvent = event;
+    record.mValueUs = (int32_t)valueUs;
+}
+
+void DashPlayerStats::dumpSyncStatistics(int fd) {
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    String8 result;
+
+    const Histogram *histograms[] = {
+        &mVideoLateness, &mAudioLatency, &mAnchorDrift,
+        &mFullSeekLatency, &mInBufferSeekLatency,
+    };
+
+    for (size_t h = 0; h < NELEM(histograms); ++h) {
+        const Histogram *hist = histograms[h];
+
+        snprintf(buffer, SIZE, "%s (ms):\n", hist->mName);
+        result.append(buffer);
+
+        for (size_t i = 0; i <= hist->mNumLimits; ++i) {
+            if (i == 0) {
+                snprintf(buffer, SIZE, "  < %lld", hist->mLimitsUs[0] / 1000);
+            } else if (i == hist->mNumLimits) {
+                snprintf(buffer, SIZE, "  >= %lld", hist->mLimitsUs[i - 1] / 1000);
+            } else {
+                snprintf(buffer, SIZE, "  %lld .. %lld",
+                        hist->mLimitsUs[i - 1] / 1000, hist->mLimitsUs[i] / 1000);
+            }
+            result.append(buffer);
+
+            snprintf(buffer, SIZE, ": %d\n", hist->mCounts[i]);
+            result.append(buffer);
+        }
+    }
+
+    // Oldest first, one "time event value" line per record
+    int32_t count = mTraceCount;
+    uint32_t first = count > kTraceSize ? count - kTraceSize : 0;
+
+    snprintf(buffer, SIZE, "sync trace (%d events):\n", count);
+    result.append(buffer);
+
+    for (uint32_t i = first; i < (uint32_t)count; ++i) {
+        const TraceRecord &record = mTrace[i % kTraceSize];
+        snprintf(buffer, SIZE, "  %lld %d %d\n",
+                record.mTimeUs, record.mEvent, record.mValueUs);
+        result.append(buffer);
+    }
+
+    write(fd, result.string(), result.size());
+}
+
 int64_t DashPlayerStats::getTimeOfDayUs() {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
 }
 
-// WARNING: Most private functions are only thread-safe within mStatsLock
+// WARNING: Most private functions are only thread-safe within mStatsLock,
+// the log*() helpers of recordLate and recordOnTime run on the renderer
+// thread instead
 inline void DashPlayerStats::logFirstFrame() {
     fprintf(mFileOut, "=====================================================\n");
     fprintf(mFileOut, "First frame latency: %lld ms\n",(getTimeOfDayUs()-mFirstFrameLatencyStartUs)/1000);
@@ -44,6 +44,8 @@ class DashPlayerStats : public RefBase {
     void setMime(const char* mime);
     void setVeryFirstFrame(bool vff);
     void notifySeek();
+    void notifyInBufferSeek();
+    void recordSeekFirstFrame();
     void incrementTotalFrames();
     void incrementDroppedFrames();
     void logStatistics();
@@ -58,8 +60,42 @@ class DashPlayerStats : public RefBase {
     void incrementTotalRenderingFrames();
     void notifyBufferingEvent();
     void setFileDescAndOutputStream(int fd);
+    void recordAudioAnchor(int64_t mediaTimeUs, int64_t realTimeUs, int64_t sinkLatencyUs);
+    void dumpSyncStatistics(int fd);
 
   private:
+    enum {
+        kMaxHistogramBuckets = 16,
+        kTraceSize = 256,
+    };
+
+    // Fixed bucket histogram, updated without locking. Bucket i counts
+    // values below mLimitsUs[i], the last bucket everything above.
+    struct Histogram {
+        const char *mName;
+        const int64_t *mLimitsUs;
+        size_t mNumLimits;
+        volatile int32_t mCounts[kMaxHistogramBuckets];
+
+        void init(const char *name, const int64_t *limitsUs, size_t numLimits);
+        void add(int64_t valueUs);
+    };
+
+    enum TraceEvent {
+        kTraceVideoLateness = 1,
+        kTraceAudioLatency  = 2,
+        kTraceAnchorDrift   = 3,
+        kTraceSeekLatency   = 4,
+    };
+
+    struct TraceRecord {
+        int64_t mTimeUs;
+        int32_t mEvent;
+        int32_t mValueUs;
+    };
+
+    void addTrace(TraceEvent event, int64_t valueUs);
+
     void logFirstFrame();
     void logCatchUp(int64_t ts, int64_t clock, int64_t delta);
     void logLate(int64_t ts, int64_t clock, int64_t delta);
@@ -90,6 +126,21 @@ class DashPlayerStats : public RefBase {
     bool mBufferingEvent;
     int mFd;
     FILE *mFileOut;
+
+    Histogram mVideoLateness;
+    Histogram mAudioLatency;
+    Histogram mAnchorDrift;
+    // Seek to first rendered frame, split by how the seek was carried out
+    Histogram mFullSeekLatency;
+    Histogram mInBufferSeekLatency;
+    volatile bool mSeekLatencyPending;
+    bool mSeekInBuffer;
+    int64_t mLastAnchorOffsetUs;
+    bool mHasAnchorOffset;
+
+    // Most recent sync events, mTraceCount wraps around kTraceSize
+    TraceRecord mTrace[kTraceSize];
+    volatile int32_t mTraceCount;
 };
 
 } // namespace android
@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "DashPlayerTextRenderer"
+#include <utils/Log.h>
+
+#include "DashPlayerTextRenderer.h"
+#include "DashPlayerDriver.h"
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/MediaErrors.h>
+
+namespace android {
+
+// static
+const int64_t DashPlayer::TextRenderer::kLeadTimeUs = 500000ll;
+
+// The renderer reports every 100 ms while playing, a clock without updates
+// for longer than this is held instead of running ahead of a stalled renderer
+// static
+const int64_t DashPlayer::TextRenderer::kMaxExtrapolationUs = 500000ll;
+
+DashPlayer::TextRenderer::TextRenderer(const wp<DashPlayerDriver> &driver)
+    : mDriver(driver),
+      mQueueGeneration(0),
+      mDrainQueuePending(false),
+      mHasPosition(false),
+      mPaused(false),
+      mPositionUs(0),
+      mPositionRealUs(0),
+      mFlushSeekTimeUs(-1) {
+    //Currently dash only support SMPTE-TT and CEA formats. No support for other timedtext types (like WebVTT, SRT)
+    mFormatNames[TIMED_TEXT_SMPTE] = String16("smptett");
+    mFormatNames[TIMED_TEXT_CEA] = String16("cea");
+    mFormatNames[TIMED_TEXT_UNKNOWN] = String16("unknown");
+}
+
+DashPlayer::TextRenderer::~TextRenderer() {
+}
+
+void DashPlayer::TextRenderer::queueText(
+        const sp<ABuffer> &accessUnit, status_t err, TimedTextType type) {
+    sp<AMessage> msg = new AMessage(kWhatQueueText, id());
+    if (accessUnit != NULL) {
+        msg->setBuffer("buffer", accessUnit);
+    }
+    msg->setInt32("err", err);
+    msg->setInt32("type", type);
+    msg->post();
+}
+
+void DashPlayer::TextRenderer::flush(int64_t seekTimeUs) {
+    {
+        Mutex::Autolock autoLock(mClockLock);
+        mHasPosition = false;
+        mFlushSeekTimeUs = seekTimeUs;
+    }
+
+    (new AMessage(kWhatFlush, id()))->post();
+}
+
+void DashPlayer::TextRenderer::updatePosition(int64_t positionUs) {
+    bool resync;
+    {
+        Mutex::Autolock autoLock(mClockLock);
+        if (mFlushSeekTimeUs >= 0) {
+            if (positionUs != mFlushSeekTimeUs) {
+                ALOGV("ignoring position %lld us from before the seek", positionUs);
+                return;
+            }
+            mFlushSeekTimeUs = -1;
+        }
+
+        // A pending drain was timed on the old clock if this position is
+        // the first one or jumps away from where the clock was heading
+        int64_t expectedUs = getPlaybackTimeUs_l();
+        resync = !mHasPosition
+                || positionUs > expectedUs + kLeadTimeUs
+                || positionUs < expectedUs - kLeadTimeUs;
+
+        mHasPosition = true;
+        mPositionUs = positionUs;
+        mPositionRealUs = ALooper::GetNowUs();
+    }
+
+    if (resync) {
+        postResync();
+    }
+}
+
+void DashPlayer::TextRenderer::pause() {
+    Mutex::Autolock autoLock(mClockLock);
+    if (!mPaused && mHasPosition) {
+        // Freeze the clock where playback stopped
+        mPositionUs = getPlaybackTimeUs_l();
+    }
+    mPaused = true;
+}
+
+void DashPlayer::TextRenderer::resume() {
+    {
+        Mutex::Autolock autoLock(mClockLock);
+        mPaused = false;
+        mPositionRealUs = ALooper::GetNowUs();
+    }
+
+    postResync();
+}
+
+void DashPlayer::TextRenderer::postResync() {
+    (new AMessage(kWhatResync, id()))->post();
+}
+
+void DashPlayer::TextRenderer::onMessageReceived(const sp<AMessage> &msg) {
+    switch (msg->what()) {
+        case kWhatQueueText:
+        {
+            QueueEntry entry;
+            msg->findBuffer("buffer", &entry.mBuffer);
+
+            int32_t err, type;
+            CHECK(msg->findInt32("err", &err));
+            CHECK(msg->findInt32("type", &type));
+            entry.mFinalResult = err;
+            entry.mType = (TimedTextType)type;
+
+            mQueue.push_back(entry);
+            if (!mDrainQueuePending) {
+                postDrainQueue();
+            }
+            break;
+        }
+
+        case kWhatDrainQueue:
+        {
+            int32_t generation;
+            CHECK(msg->findInt32("generation", &generation));
+            if (generation != mQueueGeneration) {
+                break;
+            }
+
+            mDrainQueuePending = false;
+            onDrainQueue();
+            break;
+        }
+
+        case kWhatFlush:
+        {
+            ALOGV("flushing %d text samples", mQueue.size());
+            mQueue.clear();
+            ++mQueueGeneration;
+            mDrainQueuePending = false;
+            break;
+        }
+
+        case kWhatResync:
+        {
+            // Drop the drain timed on the old clock and time it again
+            if (!mQueue.empty()) {
+                ++mQueueGeneration;
+                postDrainQueue();
+            }
+            break;
+        }
+
+        default:
+            TRESPASS();
+            break;
+    }
+}
+
+void DashPlayer::TextRenderer::postDrainQueue(int64_t delayUs) {
+    mDrainQueuePending = true;
+
+    sp<AMessage> msg = new AMessage(kWhatDrainQueue, id());
+    msg->setInt32("generation", mQueueGeneration);
+    msg->post(delayUs);
+}
+
+bool DashPlayer::TextRenderer::getPlaybackTimeUs(int64_t *playbackTimeUs) {
+    Mutex::Autolock autoLock(mClockLock);
+    if (!mHasPosition) {
+        return false;
+    }
+
+    *playbackTimeUs = getPlaybackTimeUs_l();
+    return true;
+}
+
+int64_t DashPlayer::TextRenderer::getPlaybackTimeUs_l() {
+    if (!mHasPosition || mPaused) {
+        return mPositionUs;
+    }
+
+    int64_t elapsedUs = ALooper::GetNowUs() - mPositionRealUs;
+    if (elapsedUs > kMaxExtrapolationUs) {
+        elapsedUs = kMaxExtrapolationUs;
+    }
+    return mPositionUs + elapsedUs;
+}
+
+void DashPlayer::TextRenderer::onDrainQueue() {
+    while (!mQueue.empty()) {
+        const QueueEntry &entry = *mQueue.begin();
+
+        // EOS, errors and codec config go out as soon as they are reached,
+        // and everything goes out while there is no clock yet.
+        int64_t mediaTimeUs;
+        int32_t codecConfig = 0;
+        int64_t playbackTimeUs;
+        if (entry.mBuffer != NULL
+                && entry.mFinalResult == OK
+                && !(entry.mBuffer->meta()->findInt32("conf", &codecConfig)
+                        && codecConfig)
+                && entry.mBuffer->meta()->findInt64("timeUs", &mediaTimeUs)
+                && getPlaybackTimeUs(&playbackTimeUs)) {
+            int64_t delayUs = mediaTimeUs - kLeadTimeUs - playbackTimeUs;
+            if (delayUs > 0) {
+                bool paused;
+                {
+                    Mutex::Autolock autoLock(mClockLock);
+                    paused = mPaused;
+                }
+
+                // resume() restarts the drain. The wait is capped so a clock
+                // that stalls or moves without a resync is looked at again.
+                if (!paused) {
+                    postDrainQueue(delayUs < kLeadTimeUs ? delayUs : kLeadTimeUs);
+                }
+                return;
+            }
+        }
+
+        deliver(entry);
+        mQueue.erase(mQueue.begin());
+    }
+}
+
+void DashPlayer::TextRenderer::deliver(const QueueEntry &entry) {
+    sp<DashPlayerDriver> driver = mDriver.promote();
+    if (driver == NULL) {
+        return;
+    }
+
+    Parcel &parcel = mParcel;
+    parcel.setDataSize(0);
+    parcel.setDataPosition(0);
+
+    int frameType = TIMED_TEXT_FLAG_FRAME;
+
+    //Local setting
+    parcel.writeInt32(KEY_LOCAL_SETTING);
+
+    parcel.writeInt32(KEY_TEXT_FORMAT);
+    // UPDATE TIMEDTEXT SAMPLE TYPE
+    parcel.writeString16(mFormatNames[
+            entry.mType <= TIMED_TEXT_UNKNOWN ? entry.mType : TIMED_TEXT_UNKNOWN]);
+
+    // UPDATE TIMEDTEXT SAMPLE FLAGS
+    parcel.writeInt32(KEY_TEXT_FLAG_TYPE);
+    if (entry.mFinalResult == ERROR_END_OF_STREAM ||
+        entry.mFinalResult == (status_t)UNKNOWN_ERROR ||
+        entry.mBuffer == NULL)
+    {
+       parcel.writeInt32(TIMED_TEXT_FLAG_EOS);
+       ALOGE("sendTextPacket Error End Of Stream EOS");
+       frameType = TIMED_TEXT_FLAG_EOS;
+       driver->notifyListener(MEDIA_TIMED_TEXT, 0, frameType, &parcel);
+       return;
+    }
+
+    const sp<ABuffer> &accessUnit = entry.mBuffer;
+
+    int32_t tCodecConfig = 0;
+    accessUnit->meta()->findInt32("conf", &tCodecConfig);
+    if (tCodecConfig)
+    {
+       ALOGV("Timed text codec config frame");
+       parcel.writeInt32(TIMED_TEXT_FLAG_CODEC_CONFIG);
+       frameType = TIMED_TEXT_FLAG_CODEC_CONFIG;
+    }
+    else
+    {
+       parcel.writeInt32(TIMED_TEXT_FLAG_FRAME);
+       frameType = TIMED_TEXT_FLAG_FRAME;
+    }
+
+    int32_t bDisc = 0;
+    accessUnit->meta()->findInt32("disc", &bDisc);
+    if(bDisc == 1)
+    {
+      ALOGV("sendTextPacket signal discontinuity");
+      parcel.writeInt32(KEY_TEXT_DISCONTINUITY);
+    }
+
+    // UPDATE TIMEDTEXT SAMPLE TEXT DATA
+    parcel.writeInt32(KEY_STRUCT_TEXT);
+    // write size of sample
+    parcel.writeInt32((int32_t)accessUnit->size());
+    parcel.writeInt32((int32_t)accessUnit->size());
+    // write sample payload
+    parcel.write((const uint8_t *)accessUnit->data(), accessUnit->size());
+
+    // UPDATE TIMEDTEXT SAMPLE PROPERTIES
+    int64_t mediaTimeUs = 0;
+    CHECK(accessUnit->meta()->findInt64("timeUs", &mediaTimeUs));
+    parcel.writeInt32(KEY_START_TIME);
+    parcel.writeInt32((int32_t)(mediaTimeUs / 1000));  // convert micro sec to milli sec
+
+    ALOGV("sendTextPacket Text Track Timestamp (%0.2f) sec",mediaTimeUs / 1E6);
+
+    int32_t height = 0;
+    if (accessUnit->meta()->findInt32("height", &height)) {
+        ALOGV("sendTextPacket Height (%d)",height);
+        parcel.writeInt32(KEY_HEIGHT);
+        parcel.writeInt32(height);
+    }
+
+    // width
+    int32_t width = 0;
+    if (accessUnit->meta()->findInt32("width", &width)) {
+        ALOGV("sendTextPacket width (%d)",width);
+        parcel.writeInt32(KEY_WIDTH);
+        parcel.writeInt32(width);
+    }
+
+    // Duration
+    int32_t duration = 0;
+    if (accessUnit->meta()->findInt32("duration", &duration)) {
+        ALOGV("sendTextPacket duration (%d)",duration);
+        parcel.writeInt32(KEY_DURATION);
+        parcel.writeInt32(duration);
+    }
+
+    // start offset
+    int32_t startOffset = 0;
+    if (accessUnit->meta()->findInt32("startoffset", &startOffset)) {
+        ALOGV("sendTextPacket startOffset (%d)",startOffset);
+        parcel.writeInt32(KEY_START_OFFSET);
+        parcel.writeInt32(startOffset);
+    }
+
+    // SubInfoSize
+    int32_t subInfoSize = 0;
+    if (accessUnit->meta()->findInt32("subSz", &subInfoSize)) {
+        ALOGV("sendTextPacket subInfoSize (%d)",subInfoSize);
+    }
+
+    // SubInfo
+    AString subInfo;
+    if (accessUnit->meta()->findString("subSi", &subInfo)) {
+        parcel.writeInt32(KEY_SUB_ATOM);
+        parcel.writeInt32(subInfoSize);
+        parcel.writeInt32(subInfoSize);
+        parcel.write((const uint8_t *)subInfo.c_str(), subInfoSize);
+    }
+
+    driver->notifyListener(MEDIA_TIMED_TEXT, 0, frameType, &parcel);
+}
+
+}  // namespace android
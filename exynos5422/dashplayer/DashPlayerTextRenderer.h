@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2010 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DASHPLAYER_TEXT_RENDERER_H_
+
+#define DASHPLAYER_TEXT_RENDERER_H_
+
+#include "DashPlayer.h"
+
+#include <binder/Parcel.h>
+#include <utils/List.h>
+#include <utils/String16.h>
+
+namespace android {
+
+struct ABuffer;
+
+// Turns timed text samples into listener parcels on its own looper, so
+// subtitle traffic stays off the player looper that feeds audio and video.
+// Samples are held back until they are within kLeadTimeUs of the playback
+// position reported by the renderer.
+struct DashPlayer::TextRenderer : public AHandler {
+    TextRenderer(const wp<DashPlayerDriver> &driver);
+
+    // accessUnit may be NULL when err signals EOS or an error
+    void queueText(const sp<ABuffer> &accessUnit, status_t err,
+                   TimedTextType type);
+
+    // Drops all samples not delivered yet on a seek to seekTimeUs. Renderer
+    // positions are ignored until the one reporting seekTimeUs, earlier ones
+    // still describe the old timeline.
+    void flush(int64_t seekTimeUs);
+
+    // Called with every position update of the renderer
+    void updatePosition(int64_t positionUs);
+
+    void pause();
+    void resume();
+
+protected:
+    virtual ~TextRenderer();
+
+    virtual void onMessageReceived(const sp<AMessage> &msg);
+
+private:
+    enum {
+        kWhatQueueText  = 'queT',
+        kWhatDrainQueue = 'draT',
+        kWhatFlush      = 'flus',
+        kWhatResync     = 'rsyn',
+    };
+
+    struct QueueEntry {
+        sp<ABuffer> mBuffer;
+        status_t mFinalResult;
+        TimedTextType mType;
+    };
+
+    static const int64_t kLeadTimeUs;
+    static const int64_t kMaxExtrapolationUs;
+
+    wp<DashPlayerDriver> mDriver;
+    List<QueueEntry> mQueue;
+    int32_t mQueueGeneration;
+    bool mDrainQueuePending;
+
+    // Delivery is synchronous on this looper, one parcel is reused for
+    // every sample and keeps its allocation.
+    Parcel mParcel;
+    String16 mFormatNames[TIMED_TEXT_UNKNOWN + 1];
+
+    // Playback clock, last renderer position and when it was reported
+    Mutex mClockLock;
+    bool mHasPosition;
+    bool mPaused;
+    int64_t mPositionUs;
+    int64_t mPositionRealUs;
+    int64_t mFlushSeekTimeUs;   // -1 unless waiting for the seek position
+
+    bool getPlaybackTimeUs(int64_t *playbackTimeUs);
+    int64_t getPlaybackTimeUs_l();
+    void postResync();
+
+    void onDrainQueue();
+    void postDrainQueue(int64_t delayUs = 0);
+    void deliver(const QueueEntry &entry);
+
+    DISALLOW_EVIL_CONSTRUCTORS(TextRenderer);
+};
+
+}  // namespace android
+
+#endif  // DASHPLAYER_TEXT_RENDERER_H_
@@ -24,7 +24,8 @@ LOCAL_SRC_FILES += \
 	ClientLib/ClientLib.cpp \
 	ClientLib/Session.cpp \
 	Common/CMutex.cpp \
-	Common/Connection.cpp
+	Common/Connection.cpp \
+	Common/NotificationRing.cpp
 
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/Common
 
@@ -56,9 +57,13 @@ include $(LOCAL_PATH)/Daemon/Android.mk
 LOCAL_SRC_FILES += Common/CMutex.cpp \
 	Common/Connection.cpp \
 	Common/NetlinkConnection.cpp \
+	Common/NotificationRing.cpp \
 	Common/CSemaphore.cpp \
 	Common/CThread.cpp
 
+# Shared memory for notification rings
+LOCAL_SHARED_LIBRARIES += libcutils
+
 # Includes required for the Daemon
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/ClientLib/public \
 	$(LOCAL_PATH)/Common
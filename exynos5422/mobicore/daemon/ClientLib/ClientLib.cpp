@@ -35,6 +35,8 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
 #include <list>
 #include "assert.h"
 
@@ -42,6 +44,7 @@
 
 #include "mc_linux.h"
 #include "Connection.h"
+#include "NotificationRing.h"
 #include "CMutex.h"
 #include "Device.h"
 #include "mcVersionHelper.h"
@@ -240,6 +243,7 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenDevice(uint32_t deviceId)
         // there is no payload to read
 
         device = new Device(deviceId, devCon);
+        device->daemonVersion = version;
         mcResult = device->open("/dev/" MC_USER_DEVNODE);
         if (mcResult != MC_DRV_OK) {
             delete device;
@@ -315,6 +319,75 @@ __MC_CLIENT_LIB_API mcResult_t mcCloseDevice(
 }
 
 
+//------------------------------------------------------------------------------
+/**
+ * Register the notification connection of a new session with the Daemon.
+ * Daemons which support it also hand over a shared memory notification ring,
+ * otherwise notifications only arrive through the connection.
+ */
+static mcResult_t connectNotification(
+    Device                          *device,
+    mcSessionHandle_t               *session,
+    mcDrvRspOpenSessionPayload_t    *rspOpenSessionPayload,
+    Connection                      *sessionConnection,
+    NotificationRing                **nqRing
+)
+{
+    mcResult_t mcResult = MC_DRV_OK;
+
+    *nqRing = NULL;
+
+    do {
+        if (device->daemonVersion < MC_MAKE_VERSION(0, 3)) {
+            SEND_TO_DAEMON(sessionConnection, MC_DRV_CMD_NQ_CONNECT,
+                           session->deviceId,
+                           session->sessionId,
+                           rspOpenSessionPayload->deviceSessionId,
+                           rspOpenSessionPayload->sessionMagic);
+
+            RECV_FROM_DAEMON(sessionConnection, &mcResult);
+        } else {
+            SEND_TO_DAEMON(sessionConnection, MC_DRV_CMD_NQ_CONNECT_RING,
+                           session->deviceId,
+                           session->sessionId,
+                           rspOpenSessionPayload->deviceSessionId,
+                           rspOpenSessionPayload->sessionMagic);
+
+            int fds[MAX_PASSED_FDS];
+            uint32_t numFds = MAX_PASSED_FDS;
+            int rlen = sessionConnection->readDataWithFds(&mcResult, sizeof(mcResult), fds, &numFds);
+            if (rlen != sizeof(mcResult)) {
+                LOG_E("reading from Daemon failed");
+                mcResult = MC_DRV_ERR_SOCKET_READ;
+            }
+            if ((mcResult == MC_DRV_OK) && (numFds == 2)) {
+                *nqRing = new NotificationRing(fds[0], fds[1]);
+                if (!(*nqRing)->isValid()) {
+                    // The Daemon pushes into the ring from now on, without
+                    // it notifications would be lost
+                    LOG_E("mapping the notification ring failed");
+                    delete *nqRing;
+                    *nqRing = NULL;
+                    mcResult = MC_DRV_ERR_NQ_FAILED;
+                }
+            } else {
+                for (uint32_t i = 0; i < numFds; i++) {
+                    close(fds[i]);
+                }
+            }
+        }
+
+        if (mcResult != MC_DRV_OK) {
+            LOG_E("CMD_NQ_CONNECT failed, respId=%d", mcResult);
+            break;
+        }
+
+    } while (0);
+
+    return mcResult;
+}
+
+
 //------------------------------------------------------------------------------
 __MC_CLIENT_LIB_API mcResult_t mcOpenSession(
     mcSessionHandle_t  *session,
@@ -444,21 +517,9 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenSession(
             break;
         }
 
-        do {
-            SEND_TO_DAEMON(sessionConnection, MC_DRV_CMD_NQ_CONNECT,
-                           session->deviceId,
-                           session->sessionId,
-                           rspOpenSessionPayload.deviceSessionId,
-                           rspOpenSessionPayload.sessionMagic);
-
-            RECV_FROM_DAEMON(sessionConnection, &mcResult);
-
-            if (mcResult != MC_DRV_OK) {
-                LOG_E("CMD_NQ_CONNECT failed, respId=%d", mcResult);
-                break;
-            }
-
-        } while (0);
+        NotificationRing *nqRing = NULL;
+        mcResult = connectNotification(device, session, &rspOpenSessionPayload,
+                                       sessionConnection, &nqRing);
         if (mcResult != MC_DRV_OK) {
             delete sessionConnection;
             // Here we know we couldn't communicate well with the Daemon.
@@ -470,6 +531,7 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenSession(
 
         // Session has been established, new session object must be created
         Session *sessionObj = device->createNewSession(session->sessionId, sessionConnection);
+        sessionObj->notificationRing = nqRing;
         // If the session tci was a mapped buffer then register it
         if(bulkBuf)
             sessionObj->addBulkBuf(bulkBuf);
@@ -629,21 +691,9 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenTrustlet(
             break;
         }
 
-        do {
-            SEND_TO_DAEMON(sessionConnection, MC_DRV_CMD_NQ_CONNECT,
-                           session->deviceId,
-                           session->sessionId,
-                           rspOpenSessionPayload.deviceSessionId,
-                           rspOpenSessionPayload.sessionMagic);
-
-            RECV_FROM_DAEMON(sessionConnection, &mcResult);
-
-            if (mcResult != MC_DRV_OK) {
-                LOG_E("CMD_NQ_CONNECT failed, respId=%d", mcResult);
-                break;
-            }
-
-        } while (0);
+        NotificationRing *nqRing = NULL;
+        mcResult = connectNotification(device, session, &rspOpenSessionPayload,
+                                       sessionConnection, &nqRing);
 
         if (mcResult != MC_DRV_OK) {
             delete sessionConnection;
@@ -656,6 +706,7 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenTrustlet(
 
         // Session has been established, new session object must be created
         Session *sessionObj = device->createNewSession(session->sessionId, sessionConnection);
+        sessionObj->notificationRing = nqRing;
         // If the session tci was a mapped buffer then register it
         if(bulkBuf)
             sessionObj->addBulkBuf(bulkBuf);
@@ -783,13 +834,12 @@ __MC_CLIENT_LIB_API mcResult_t mcWaitNotification(
         Session  *nqSession = device->resolveSessionId(session->sessionId);
         CHECK_SESSION(nqSession, session->sessionId);
 
-        Connection *nqconnection = nqSession->notificationConnection;
         uint32_t count = 0;
 
         // Read notification queue till it's empty
         for (;;) {
             notification_t notification;
-            ssize_t numRead = nqconnection->readData(
+            ssize_t numRead = nqSession->readNotification(
                                   &notification,
                                   sizeof(notification_t),
                                   timeout);
@@ -934,6 +984,15 @@ __MC_CLIENT_LIB_API mcResult_t mcFreeWsm(
     return mcResult;
 }
 
+//------------------------------------------------------------------------------
+static uint32_t getElapsedUs(const struct timespec *startTime)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - startTime->tv_sec) * 1000000
+           + (now.tv_nsec - startTime->tv_nsec) / 1000;
+}
+
 //------------------------------------------------------------------------------
 __MC_CLIENT_LIB_API mcResult_t mcMap(
     mcSessionHandle_t  *sessionHandle,
@@ -944,9 +1003,12 @@ __MC_CLIENT_LIB_API mcResult_t mcMap(
 {
     mcResult_t mcResult = MC_DRV_ERR_UNKNOWN;
     static CMutex mutex;
+    Session *session = NULL;
+    struct timespec startTime;
 
     LOG_I("===%s()===", __FUNCTION__);
 
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
     devMutex.lock();
 
     do {
@@ -965,13 +1027,25 @@ __MC_CLIENT_LIB_API mcResult_t mcMap(
         Connection *devCon = device->connection;
 
         // Get session
-        Session *session = device->resolveSessionId(sessionHandle->sessionId);
+        session = device->resolveSessionId(sessionHandle->sessionId);
         CHECK_SESSION(session, sessionHandle->sessionId);
 
         LOG_I(" Mapping %p to session %d.", buf, sessionHandle->sessionId);
 
+        // The same region is already mapped, share its L2 table and secure
+        // virtual address instead of registering it again
+        BulkBufferDescriptor *bulkBuf = session->findBulkBuf(buf, bufLen);
+        if ((bulkBuf != NULL) && (bulkBuf->sVirtualAddr != NULL)) {
+            bulkBuf->refCount++;
+            session->mapCacheHits++;
+            mapInfo->sVirtualAddr = bulkBuf->sVirtualAddr;
+            mapInfo->sVirtualLen = bufLen;
+            mcResult = MC_DRV_OK;
+            break;
+        }
+        session->mapCacheMisses++;
+
         // Register mapped bulk buffer to Kernel Module and keep mapped bulk buffer in mind
-        BulkBufferDescriptor *bulkBuf;
         mcResult = session->addBulkBuf(buf, bufLen, &bulkBuf);
         if (mcResult != MC_DRV_OK) {
             LOG_E("Registering buffer failed. ret=%x", mcResult);
@@ -995,7 +1069,7 @@ __MC_CLIENT_LIB_API mcResult_t mcMap(
 
             // Unregister mapped bulk buffer from Kernel Module and remove mapped
             // bulk buffer from session maintenance
-            if (session->removeBulkBuf(buf) != MC_DRV_OK) {
+            if (session->removeBulkBuf(buf, bufLen) != MC_DRV_OK) {
                 // Removing of bulk buffer not possible
                 LOG_E("Unregistering of bulk memory from Kernel Module failed");
             }
@@ -1014,6 +1088,12 @@ __MC_CLIENT_LIB_API mcResult_t mcMap(
 
     } while (false);
 
+    if (mcResult == MC_DRV_OK) {
+        LOG_I(" Mapping took %u us, %u of %u maps reused a mapping.",
+              getElapsedUs(&startTime), session->mapCacheHits,
+              session->mapCacheHits + session->mapCacheMisses);
+    }
+
 //    // TODO: enable as soon as there are more error codes
 //    if (mcResult == MC_DRV_ERR_SOCKET_WRITE || mcResult == MC_DRV_ERR_SOCKET_READ) {
 //        LOG_E("Connection is dead, removing device.");
@@ -1034,9 +1114,11 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
 {
     mcResult_t mcResult = MC_DRV_ERR_UNKNOWN;
     static CMutex mutex;
+    struct timespec startTime;
 
     LOG_I("===%s()===", __FUNCTION__);
 
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
     devMutex.lock();
 
     do {
@@ -1067,6 +1149,22 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
 
         LOG_I(" Unmapping %p(handle=%u) from session %d.", buf, handle, sessionHandle->sessionId);
 
+        // The region mcMap() returned mapInfo for, it must be the one the
+        // handle belongs to
+        BulkBufferDescriptor *bulkBuf = session->findBulkBuf(buf, mapInfo->sVirtualLen);
+        if ((bulkBuf == NULL) || (bulkBuf->handle != handle)) {
+            LOG_E("%p(len=%u) is not mapped at %p.", buf, mapInfo->sVirtualLen, mapInfo->sVirtualAddr);
+            mcResult = MC_DRV_ERR_BLK_BUFF_NOT_FOUND;
+            break;
+        }
+
+        // Other mcMap() calls still use the mapping
+        if (bulkBuf->refCount > 1) {
+            bulkBuf->refCount--;
+            mcResult = MC_DRV_OK;
+            break;
+        }
+
         SEND_TO_DAEMON(devCon, MC_DRV_CMD_UNMAP_BULK_BUF,
                        session->sessionId,
                        handle,
@@ -1084,7 +1182,7 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
 
         // Unregister mapped bulk buffer from Kernel Module and remove mapped
         // bulk buffer from session maintenance
-        mcResult = session->removeBulkBuf(buf);
+        mcResult = session->removeBulkBuf(buf, mapInfo->sVirtualLen);
         if (mcResult != MC_DRV_OK) {
             LOG_E("Unregistering of bulk memory from Kernel Module failed.");
             break;
@@ -1094,6 +1192,10 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
 
     } while (false);
 
+    if (mcResult == MC_DRV_OK) {
+        LOG_I(" Unmapping took %u us.", getElapsedUs(&startTime));
+    }
+
     if (mcResult == MC_DRV_ERR_SOCKET_WRITE || mcResult == MC_DRV_ERR_SOCKET_READ) {
         LOG_E("Connection is dead, removing device.");
         removeDevice(sessionHandle->deviceId);
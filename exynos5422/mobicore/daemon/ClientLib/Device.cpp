@@ -47,6 +47,7 @@ Device::Device(uint32_t deviceId, Connection *connection)
 {
     this->deviceId = deviceId;
     this->connection = connection;
+    this->daemonVersion = 0;
 
     pMcKMod = new CMcKMod();
 }
@@ -63,6 +64,7 @@ Device::~Device(void)
         delete (*sessionIterator);
         sessionIterator = sessionList.erase(sessionIterator);
     }
+    sessionIndex.clear();
 
     // Free all allocated WSM descriptors
     wsmIterator_t  wsmIterator = wsmL2List.begin();
@@ -75,6 +77,7 @@ Device::~Device(void)
         delete (*wsmIterator);
         wsmIterator = wsmL2List.erase(wsmIterator);
     }
+    wsmL2Index.clear();
     delete connection;
     delete pMcKMod;
 }
@@ -105,7 +108,7 @@ bool Device::hasSessions(void)
 Session *Device::createNewSession(uint32_t sessionId, Connection  *connection)
 {
     Session *session = new Session(sessionId, pMcKMod, connection);
-    sessionList.push_back(session);
+    sessionIndex[sessionId] = sessionList.insert(sessionList.end(), session);
     return session;
 }
 
@@ -113,38 +116,26 @@ Session *Device::createNewSession(uint32_t sessionId, Connection  *connection)
 //------------------------------------------------------------------------------
 bool Device::removeSession(uint32_t sessionId)
 {
-    bool ret = false;
-
-    sessionIterator_t interator = sessionList.begin();
-    while (interator != sessionList.end()) {
-        if ((*interator)->sessionId == sessionId) {
-            delete (*interator);
-            interator = sessionList.erase(interator);
-            ret = true;
-            break;
-        } else {
-            interator++;
-        }
+    sessionMap_t::iterator found = sessionIndex.find(sessionId);
+    if (found == sessionIndex.end()) {
+        return false;
     }
-    return ret;
+
+    delete *(found->second);
+    sessionList.erase(found->second);
+    sessionIndex.erase(found);
+    return true;
 }
 
 
 //------------------------------------------------------------------------------
 Session *Device::resolveSessionId(uint32_t sessionId)
 {
-    Session  *ret = NULL;
-
-    // Get Session for sessionId
-    for ( sessionIterator_t interator = sessionList.begin();
-            interator != sessionList.end();
-            ++interator) {
-        if ((*interator)->sessionId == sessionId) {
-            ret = (*interator);
-            break;
-        }
+    sessionMap_t::iterator found = sessionIndex.find(sessionId);
+    if (found == sessionIndex.end()) {
+        return NULL;
     }
-    return ret;
+    return *(found->second);
 }
 
 
@@ -173,7 +164,7 @@ mcResult_t Device::allocateContiguousWsm(uint32_t len, CWsm **wsm)
     // Register (vaddr,paddr) with device
     *wsm = new CWsm(virtAddr, len, handle, physAddr);
 
-    wsmL2List.push_back(*wsm);
+    wsmL2Index[virtAddr] = wsmL2List.insert(wsmL2List.end(), *wsm);
 
     // Return pointer to the allocated memory
     return MC_DRV_OK;
@@ -184,16 +175,16 @@ mcResult_t Device::allocateContiguousWsm(uint32_t len, CWsm **wsm)
 mcResult_t Device::freeContiguousWsm(CWsm_ptr  pWsm)
 {
     mcResult_t ret = MC_DRV_ERR_WSM_NOT_FOUND;
-    wsmIterator_t iterator;
+    wsmMap_t::iterator found = wsmL2Index.find(pWsm->virtAddr);
 
-    for (iterator = wsmL2List.begin(); iterator != wsmL2List.end(); ++iterator) {
-        if (pWsm == *iterator) {
-            ret = MC_DRV_OK;
-            break;
-        }
+    if ((found != wsmL2Index.end()) && (*(found->second) == pWsm)) {
+        ret = MC_DRV_OK;
     }
     // We just looked this up using findContiguousWsm
     assert(ret == MC_DRV_OK);
+    if (ret != MC_DRV_OK) {
+        return ret;
+    }
 
     LOG_I(" unmapping handle %d from %p, phys=%p",
           pWsm->handle, pWsm->virtAddr, pWsm->physAddr);
@@ -204,7 +195,8 @@ mcResult_t Device::freeContiguousWsm(CWsm_ptr  pWsm)
         return ret;
     }
 
-    iterator = wsmL2List.erase(iterator);
+    wsmL2List.erase(found->second);
+    wsmL2Index.erase(found);
     delete pWsm;
 
     return ret;
@@ -214,19 +206,11 @@ mcResult_t Device::freeContiguousWsm(CWsm_ptr  pWsm)
 //------------------------------------------------------------------------------
 CWsm_ptr Device::findContiguousWsm(addr_t  virtAddr)
 {
-    CWsm_ptr pWsm = NULL;
-
-    for ( wsmIterator_t iterator = wsmL2List.begin();
-            iterator != wsmL2List.end();
-            ++iterator) {
-        CWsm_ptr pTmpWsm = *iterator;
-        if (virtAddr == pTmpWsm->virtAddr) {
-            pWsm = pTmpWsm;
-            break;
-        }
+    wsmMap_t::iterator found = wsmL2Index.find(virtAddr);
+    if (found == wsmL2Index.end()) {
+        return NULL;
     }
-
-    return pWsm;
+    return *(found->second);
 }
 
 
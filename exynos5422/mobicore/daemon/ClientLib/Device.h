@@ -37,23 +37,30 @@
 
 #include <stdint.h>
 #include <vector>
+#include <map>
 
 #include "public/MobiCoreDriverApi.h"
 #include "Session.h"
 #include "CWsm.h"
 
 
+typedef std::map<uint32_t, sessionIterator_t> sessionMap_t;
+typedef std::map<addr_t, wsmIterator_t> wsmMap_t;
+
 class Device
 {
 
 private:
     sessionList_t   sessionList; /**< MobiCore Trustlet session associated with the device */
+    sessionMap_t    sessionIndex; /**< Position in sessionList by session ID */
     wsmList_t       wsmL2List; /**< WSM L2 Table  */
+    wsmMap_t        wsmL2Index; /**< Position in wsmL2List by virtual address */
 
 
 public:
     uint32_t     deviceId; /**< Device identifier */
     Connection   *connection; /**< The device connection */
+    uint32_t     daemonVersion; /**< Socket interface version of the Daemon */
     CMcKMod_ptr  pMcKMod;
 
     Device(
@@ -36,6 +36,9 @@
 
 #include "log.h"
 #include <assert.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
 
 
 //------------------------------------------------------------------------------
@@ -47,6 +50,9 @@ Session::Session(
     this->sessionId = sessionId;
     this->mcKMod = mcKMod;
     this->notificationConnection = connection;
+    this->notificationRing = NULL;
+    this->mapCacheHits = 0;
+    this->mapCacheMisses = 0;
 
     sessionInfo.lastErr = SESSION_ERR_NO;
     sessionInfo.state = SESSION_STATE_INITIAL;
@@ -78,13 +84,61 @@ Session::~Session(void)
         delete(pBlkBufDescr);
     }
 
-    // Finally delete notification connection
+    // Finally delete notification channel
+    delete notificationRing;
     delete notificationConnection;
 
     unlock();
 }
 
 
+//------------------------------------------------------------------------------
+ssize_t Session::readNotification(void *notification, uint32_t len, int32_t timeout)
+{
+    if (notificationRing == NULL) {
+        return notificationConnection->readData(notification, len, timeout);
+    }
+
+    assert(len == sizeof(nqRingEntry_t));
+
+    for (;;) {
+        if (notificationRing->pop((nqRingEntry_t *)notification)) {
+            return len;
+        }
+
+        // The socket carries ring overflow and tells us if the Daemon died
+        struct pollfd fds[2];
+        fds[0].fd = notificationRing->eventFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = notificationConnection->socketDescriptor;
+        fds[1].events = POLLIN | POLLRDHUP;
+
+        int ret = poll(fds, 2, timeout);
+        if (ret < 0) {
+            LOG_ERRNO("poll");
+            return -1;
+        }
+        if (ret == 0) {
+            LOG_W(" Timeout during poll() / No more notifications.");
+            return -2;
+        }
+
+        if (fds[1].revents != 0) {
+            // The Daemon only writes to the socket once the ring overflowed,
+            // everything still in the ring is older than the socket data
+            if (notificationRing->pop((nqRingEntry_t *)notification)) {
+                return len;
+            }
+            return notificationConnection->readData(notification, len, 0);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            notificationRing->clearEvent();
+        }
+    }
+}
+
+
 //------------------------------------------------------------------------------
 void Session::setErrorInfo(
     int32_t err
@@ -149,6 +203,19 @@ void Session::addBulkBuf(BulkBufferDescriptor *blkBuf)
         bulkBufferDescriptors.push_back(blkBuf);
 }
 
+//------------------------------------------------------------------------------
+BulkBufferDescriptor *Session::findBulkBuf(addr_t buf, uint32_t len)
+{
+    for ( bulkBufferDescrIterator_t iterator = bulkBufferDescriptors.begin();
+            iterator != bulkBufferDescriptors.end();
+            ++iterator ) {
+        if (((*iterator)->virtAddr == buf) && ((*iterator)->len == len)) {
+            return *iterator;
+        }
+    }
+    return NULL;
+}
+
 //------------------------------------------------------------------------------
 uint32_t Session::getBufHandle(addr_t sVirtAddr)
 {
@@ -166,7 +233,7 @@ uint32_t Session::getBufHandle(addr_t sVirtAddr)
 }
 
 //------------------------------------------------------------------------------
-mcResult_t Session::removeBulkBuf(addr_t virtAddr)
+mcResult_t Session::removeBulkBuf(addr_t virtAddr, uint32_t len)
 {
     BulkBufferDescriptor  *pBlkBufDescr = NULL;
 
@@ -178,7 +245,7 @@ mcResult_t Session::removeBulkBuf(addr_t virtAddr)
             ++iterator
         ) {
 
-        if ((*iterator)->virtAddr == virtAddr) {
+        if (((*iterator)->virtAddr == virtAddr) && ((*iterator)->len == len)) {
             pBlkBufDescr = *iterator;
             iterator = bulkBufferDescriptors.erase(iterator);
             break;
@@ -35,6 +35,7 @@
 
 #include "mc_linux.h"
 #include "Connection.h"
+#include "NotificationRing.h"
 #include "CMcKMod.h"
 #include "CMutex.h"
 
@@ -47,6 +48,7 @@ public:
     uint32_t  len; /**< Length of the Bulk buffer*/
     uint32_t  handle;
     addr_t    physAddrWsmL2; /**< The physical address of the L2 table of the Bulk buffer*/
+    uint32_t  refCount; /**< Number of mcMap() calls sharing this mapping */
 
     BulkBufferDescriptor(
         addr_t    virtAddr,
@@ -59,7 +61,8 @@ public:
         sVirtualAddr(sVirtAddr),
         len(len),
         handle(handle),
-        physAddrWsmL2(physAddrWsmL2)
+        physAddrWsmL2(physAddrWsmL2),
+        refCount(1)
     {};
 
 };
@@ -98,7 +101,10 @@ private:
     sessionInformation_t sessionInfo; /**< Informations about session */
 public:
     uint32_t sessionId;
+    uint32_t mapCacheHits; /**< mcMap() calls served by an existing mapping */
+    uint32_t mapCacheMisses; /**< mcMap() calls which created a mapping */
     Connection *notificationConnection;
+    NotificationRing *notificationRing; /**< Optional ring, NULL if unused */
 
     Session(uint32_t sessionId, CMcKMod *mcKMod, Connection *connection);
 
@@ -134,10 +140,21 @@ public:
      * unregister virtual memory in kernel module
      *
      * @param buf The virtual address of the bulk buffer.
+     * @param len Length of the bulk buffer.
      *
      * @return true on success.
      */
-    mcResult_t removeBulkBuf(addr_t buf);
+    mcResult_t removeBulkBuf(addr_t buf, uint32_t len);
+
+    /**
+     * Find the descriptor of a bulk buffer.
+     *
+     * @param buf The virtual address of the bulk buffer.
+     * @param len Length of the bulk buffer.
+     *
+     * @return the descriptor or NULL if the region is not mapped
+     */
+    BulkBufferDescriptor *findBulkBuf(addr_t buf, uint32_t len);
 
     /**
      * Return the Kmod handle of the bulk buff
@@ -148,6 +165,20 @@ public:
      */
     uint32_t getBufHandle(addr_t sVirtualAddr);
 
+    /**
+     * Read one notification from the ring or the notification connection.
+     * The ring has a single consumer, so only the thread waiting for this
+     * session may call this.
+     *
+     * @param notification  Destination buffer.
+     * @param len           Size of a notification.
+     * @param timeout       Timeout in milliseconds, -1 waits forever.
+     * @return Number of bytes read, 0 if the Daemon closed the connection.
+     * @return -1 on error.
+     * @return -2 if no notification arrived before the timeout.
+     */
+    ssize_t readNotification(void *notification, uint32_t len, int32_t timeout);
+
     /**
      * Set additional error information of the last error that occured.
      *
@@ -49,6 +49,8 @@
 Connection::Connection(void)
 {
     connectionData = NULL;
+    bytesRead = 0;
+    bytesWritten = 0;
     // Set invalid socketDescriptor
     socketDescriptor = -1;
 }
@@ -63,6 +65,8 @@ Connection::Connection(int socketDescriptor, sockaddr_un *remote)
     this->socketDescriptor = socketDescriptor;
     this->remote = *remote;
     connectionData = NULL;
+    bytesRead = 0;
+    bytesWritten = 0;
 }
 
 
@@ -158,6 +162,8 @@ size_t Connection::readData(void *buffer, uint32_t len, int32_t timeout)
     ret = recv(socketDescriptor, buffer, len, MSG_DONTWAIT);
     if (ret == 0) {
         LOG_V(" readData(): peer orderly closed connection.");
+    } else if ((int)ret > 0) {
+        bytesRead += ret;
     }
 
     return ret;
@@ -175,6 +181,97 @@ size_t Connection::writeData(void *buffer, uint32_t len)
         LOG_ERRNO("could not send all data, because send");
         LOG_E("ret = %d", ret);
         ret = -1;
+    } else {
+        bytesWritten += ret;
+    }
+
+    return ret;
+}
+
+
+//------------------------------------------------------------------------------
+size_t Connection::writeDataWithFds(void *buffer, uint32_t len, int *fds, uint32_t numFds)
+{
+    char control[CMSG_SPACE(MAX_PASSED_FDS * sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+
+    assert(buffer != NULL);
+    assert(socketDescriptor != -1);
+    assert(numFds <= MAX_PASSED_FDS);
+
+    iov.iov_base = buffer;
+    iov.iov_len = len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (numFds > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(numFds * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(numFds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, numFds * sizeof(int));
+    }
+
+    size_t ret = sendmsg(socketDescriptor, &msg, 0);
+    if (ret != len) {
+        LOG_ERRNO("could not send all data, because sendmsg");
+        LOG_E("ret = %d", ret);
+        ret = -1;
+    } else {
+        bytesWritten += ret;
+    }
+
+    return ret;
+}
+
+
+//------------------------------------------------------------------------------
+size_t Connection::readDataWithFds(void *buffer, uint32_t len, int *fds, uint32_t *numFds)
+{
+    char control[CMSG_SPACE(MAX_PASSED_FDS * sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+    uint32_t maxFds = *numFds;
+
+    assert(buffer != NULL);
+    assert(socketDescriptor != -1);
+
+    *numFds = 0;
+    iov.iov_base = buffer;
+    iov.iov_len = len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    size_t ret = recvmsg(socketDescriptor, &msg, 0);
+    if ((int)ret <= 0) {
+        LOG_V(" readDataWithFds(): connection closed or failed.");
+        return ret;
+    }
+    bytesRead += ret;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg != NULL;
+            cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS)) {
+            continue;
+        }
+        uint32_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        int *passed = (int *)CMSG_DATA(cmsg);
+        for (uint32_t i = 0; i < count; i++) {
+            // Close what the caller has no room for
+            if (*numFds < maxFds) {
+                fds[(*numFds)++] = passed[i];
+            } else {
+                close(passed[i]);
+            }
+        }
     }
 
     return ret;
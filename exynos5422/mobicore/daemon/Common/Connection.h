@@ -42,6 +42,9 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
+/** Maximum number of file descriptors passed with one message. */
+#define MAX_PASSED_FDS  (4)
+
 
 class Connection
 {
@@ -50,6 +53,8 @@ public:
     int32_t socketDescriptor; /**< Local socket descriptor */
     void *connectionData; /**< reference to data related with the connection */
     bool detached; /**< Connection state */
+    uint32_t bytesRead; /**< Payload bytes received so far */
+    uint32_t bytesWritten; /**< Payload bytes sent so far */
 
     Connection(void);
 
@@ -96,6 +101,29 @@ public:
      */
     virtual size_t writeData(void *buffer, uint32_t len);
 
+    /**
+     * Write bytes to the connection and pass file descriptors along.
+     *
+     * @param buffer    Pointer to source buffer.
+     * @param len       Number of bytes to write.
+     * @param fds       File descriptors to pass.
+     * @param numFds    Number of file descriptors.
+     * @return Number of bytes written.
+     * @return -1 if written bytes not equal to len.
+     */
+    virtual size_t writeDataWithFds(void *buffer, uint32_t len, int *fds, uint32_t numFds);
+
+    /**
+     * Read bytes from the connection and collect passed file descriptors.
+     *
+     * @param buffer    Pointer to destination buffer.
+     * @param len       Number of bytes to read.
+     * @param fds       Destination of received file descriptors.
+     * @param numFds    In: size of fds. Out: number of descriptors received.
+     * @return Number of bytes read.
+     */
+    virtual size_t readDataWithFds(void *buffer, uint32_t len, int *fds, uint32_t *numFds);
+
     /**
      * Wait for data to be available.
      *
@@ -219,6 +219,7 @@ size_t NetlinkConnection::readData(
         // Still some data left
         dataLeft.signal();
     }
+    bytesRead += ret;
     dataMutex.unlock();
 
     //LOG_I("%s: read %u", __FUNCTION__, ret);
@@ -276,6 +277,7 @@ size_t NetlinkConnection::writeData(
         /* The whole message sent also includes the header, so make sure to
          * return only the number of payload data sent, not everything */
         ret = len;
+        bytesWritten += len;
     }
 
     free(nlh);
@@ -0,0 +1,139 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_SRV
+ * @{
+ * @file
+ *
+ * Shared memory notification ring.
+ */
+
+/* <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <unistd.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <string.h>
+
+#include "NotificationRing.h"
+
+//#define LOG_VERBOSE
+#include "log.h"
+
+
+//------------------------------------------------------------------------------
+NotificationRing::NotificationRing(int memFd, int eventFd)
+{
+    this->memFd = memFd;
+    this->eventFd = eventFd;
+    ring = NULL;
+
+    if ((memFd < 0) || (eventFd < 0)) {
+        return;
+    }
+
+    void *mem = mmap(NULL, sizeof(nqRingBuffer_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, memFd, 0);
+    if (mem == MAP_FAILED) {
+        LOG_ERRNO("mmap");
+        return;
+    }
+    ring = (nqRingBuffer_t *)mem;
+}
+
+
+//------------------------------------------------------------------------------
+NotificationRing::~NotificationRing(void)
+{
+    if (ring != NULL) {
+        munmap(ring, sizeof(nqRingBuffer_t));
+    }
+    if (memFd >= 0) {
+        close(memFd);
+    }
+    if (eventFd >= 0) {
+        close(eventFd);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+bool NotificationRing::isValid(void)
+{
+    return (ring != NULL);
+}
+
+
+//------------------------------------------------------------------------------
+bool NotificationRing::push(const nqRingEntry_t *entry)
+{
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= NQ_RING_ENTRIES) {
+        LOG_V(" Notification ring full");
+        return false;
+    }
+
+    ring->entries[head % NQ_RING_ENTRIES] = *entry;
+    // The entry must be visible before the consumer sees the new head
+    __sync_synchronize();
+    ring->head = head + 1;
+
+    uint64_t event = 1;
+    if (write(eventFd, &event, sizeof(event)) != sizeof(event)) {
+        LOG_ERRNO("eventfd write");
+    }
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+bool NotificationRing::pop(nqRingEntry_t *entry)
+{
+    uint32_t tail = ring->tail;
+
+    if (tail == ring->head) {
+        return false;
+    }
+
+    // Read the entry only after the head which published it
+    __sync_synchronize();
+    *entry = ring->entries[tail % NQ_RING_ENTRIES];
+    // The slot may be reused once the producer sees the new tail
+    __sync_synchronize();
+    ring->tail = tail + 1;
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+void NotificationRing::clearEvent(void)
+{
+    uint64_t event;
+    if (read(eventFd, &event, sizeof(event)) != sizeof(event)) {
+        LOG_ERRNO("eventfd read");
+    }
+}
+
+/** @} */
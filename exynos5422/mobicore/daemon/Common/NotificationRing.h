@@ -0,0 +1,113 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_SRV
+ * @{
+ * @file
+ *
+ * Shared memory notification ring between Daemon and Client Library.
+ *
+ * The Daemon is the only producer and the Client Library the only consumer
+ * of a ring. Each ring belongs to one trustlet session. The Daemon signals
+ * new entries through an eventfd. The notification socket stays open and
+ * carries notifications which did not fit into the ring.
+ *
+ * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef NOTIFICATIONRING_H_
+#define NOTIFICATIONRING_H_
+
+#include <inttypes.h>
+
+/** Number of notifications the ring can hold. */
+#define NQ_RING_ENTRIES     (64)
+
+/** Ring entry, same layout as notification_t. */
+typedef struct {
+    uint32_t sessionId; /**< Session ID. */
+    int32_t payload; /**< Additional notification information. */
+} nqRingEntry_t;
+
+/**
+ * Ring layout in shared memory. Single producer, the Daemon, and single
+ * consumer, the client session: head and tail are plain volatile indices
+ * without locking, so no two threads may pop from the same ring.
+ */
+typedef struct {
+    volatile uint32_t head; /**< Written by the producer only */
+    volatile uint32_t tail; /**< Written by the consumer only */
+    nqRingEntry_t entries[NQ_RING_ENTRIES];
+} nqRingBuffer_t;
+
+
+class NotificationRing
+{
+private:
+    nqRingBuffer_t *ring;
+
+public:
+    int memFd; /**< Shared memory backing the ring */
+    int eventFd; /**< Signals new entries to the consumer */
+
+    /**
+     * Map a notification ring. Takes ownership of both descriptors.
+     *
+     * @param memFd     Shared memory of at least sizeof(nqRingBuffer_t) bytes.
+     * @param eventFd   eventfd used for wakeup.
+     */
+    NotificationRing(int memFd, int eventFd);
+
+    virtual ~NotificationRing(void);
+
+    /**
+     * @return true if the ring has been mapped.
+     */
+    bool isValid(void);
+
+    /**
+     * Add a notification and wake up the consumer.
+     *
+     * @param entry Notification to add.
+     * @return false if the ring is full.
+     */
+    bool push(const nqRingEntry_t *entry);
+
+    /**
+     * Take the oldest notification.
+     *
+     * @param entry Destination of the notification.
+     * @return false if the ring is empty.
+     */
+    bool pop(nqRingEntry_t *entry);
+
+    /**
+     * Reset the wakeup event. Must be called before draining the ring so that
+     * an entry pushed meanwhile raises the event again.
+     */
+    void clearEvent(void);
+};
+
+#endif /* NOTIFICATIONRING_H_ */
+
+/** @} */
@@ -5,7 +5,8 @@
 # =============================================================================
 
 # Add new source files here
-LOCAL_SRC_FILES += Daemon/MobiCoreDriverDaemon.cpp
+LOCAL_SRC_FILES += Daemon/MobiCoreDriverDaemon.cpp \
+	Daemon/CommandTrace.cpp
 
 # Includes required for the Daemon
 LOCAL_C_INCLUDES += $(LOCAL_PATH)/Daemon/public \
@@ -0,0 +1,116 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_CONHDLR
+ * @{
+ * @file
+ *
+ * Command trace of the MobiCore Driver Daemon.
+ *
+ * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "CommandTrace.h"
+
+#include "log.h"
+
+
+//------------------------------------------------------------------------------
+CommandTrace::CommandTrace(void)
+{
+    memset(records, 0, sizeof(records));
+    numRecords = 0;
+}
+
+
+//------------------------------------------------------------------------------
+void CommandTrace::record(const mcDrvTraceRecord_t *record)
+{
+    records[numRecords % TRACE_RECORDS] = *record;
+    numRecords++;
+
+    // New entries come value initialized, i.e. all zero
+    histogram_t &hist = histograms[record->commandId];
+    hist.count++;
+    hist.totalUs += record->latencyUs;
+    hist.totalQueueUs += record->queueUs;
+    if (record->latencyUs > hist.maxUs) {
+        hist.maxUs = record->latencyUs;
+    }
+
+    uint32_t bucket = 0;
+    while ((bucket < TRACE_BUCKETS - 1) && (record->latencyUs >> bucket) != 0) {
+        bucket++;
+    }
+    hist.buckets[bucket]++;
+}
+
+
+//------------------------------------------------------------------------------
+uint32_t CommandTrace::copyRecords(mcDrvTraceRecord_t *records)
+{
+    uint32_t count = numRecords;
+    uint32_t first = 0;
+
+    if (count > TRACE_RECORDS) {
+        first = numRecords % TRACE_RECORDS;
+        count = TRACE_RECORDS;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        records[i] = this->records[(first + i) % TRACE_RECORDS];
+    }
+
+    return count;
+}
+
+
+//------------------------------------------------------------------------------
+void CommandTrace::logHistograms(void)
+{
+    LOG_I("Command trace: %u commands handled", numRecords);
+
+    for (histogramMap_t::iterator it = histograms.begin();
+            it != histograms.end();
+            ++it) {
+        histogram_t &hist = it->second;
+        char line[TRACE_BUCKETS * 8 + 1];
+        size_t pos = 0;
+
+        for (uint32_t i = 0; i < TRACE_BUCKETS; i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, " %u", hist.buckets[i]);
+            if (pos >= sizeof(line)) {
+                break;
+            }
+        }
+        LOG_I(" cmd 0x%x: count=%u avg=%uus max=%uus queue avg=%uus",
+              it->first, hist.count,
+              (uint32_t)(hist.totalUs / hist.count), hist.maxUs,
+              (uint32_t)(hist.totalQueueUs / hist.count));
+        LOG_I("  log2 us buckets:%s", line);
+    }
+}
+
+/** @} */
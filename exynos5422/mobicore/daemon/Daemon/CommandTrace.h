@@ -0,0 +1,95 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_CONHDLR
+ * @{
+ * @file
+ *
+ * Command trace of the MobiCore Driver Daemon.
+ *
+ * Keeps the most recent handled commands with their lock wait, latency and
+ * payload sizes, plus a log2 latency histogram per command ID. All access
+ * happens under the command lock of the Daemon, so no locking of its own.
+ *
+ * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef COMMANDTRACE_H_
+#define COMMANDTRACE_H_
+
+#include <inttypes.h>
+#include <map>
+
+#include "MobiCoreDriverApi.h"
+#include "MobiCoreDriverCmd.h"
+
+/** Number of records kept for MC_DRV_CMD_GET_TRACE. */
+#define TRACE_RECORDS       (256)
+/** Histogram buckets, bucket n counts latencies below 2^n us. */
+#define TRACE_BUCKETS       (16)
+
+
+class CommandTrace
+{
+public:
+    CommandTrace(void);
+
+    /**
+     * Add a handled command to the trace.
+     *
+     * @param record Command measurements.
+     */
+    void record(const mcDrvTraceRecord_t *record);
+
+    /**
+     * Copy the recorded commands, oldest first.
+     *
+     * @param records Destination of at least TRACE_RECORDS entries.
+     * @return Number of records copied.
+     */
+    uint32_t copyRecords(mcDrvTraceRecord_t *records);
+
+    /**
+     * Print the latency histograms of all commands seen so far.
+     */
+    void logHistograms(void);
+
+private:
+    typedef struct {
+        uint32_t count;
+        uint64_t totalUs;
+        uint32_t maxUs;
+        uint64_t totalQueueUs;
+        uint32_t buckets[TRACE_BUCKETS];
+    } histogram_t;
+
+    typedef std::map<uint32_t, histogram_t> histogramMap_t;
+
+    mcDrvTraceRecord_t records[TRACE_RECORDS];
+    uint32_t numRecords; /**< Total records ever added */
+    histogramMap_t histograms;
+};
+
+#endif /* COMMANDTRACE_H_ */
+
+/** @} */
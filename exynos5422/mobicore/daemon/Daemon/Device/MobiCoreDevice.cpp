@@ -39,6 +39,7 @@
 #include "DeviceIrqHandler.h"
 #include "ExcDevice.h"
 #include "Connection.h"
+#include "CMutex.h"
 #include "TrustletSession.h"
 
 #include "MobiCoreDevice.h"
@@ -66,15 +67,11 @@ MobiCoreDevice::~MobiCoreDevice()
 //------------------------------------------------------------------------------
 TrustletSession *MobiCoreDevice::getTrustletSession(uint32_t sessionId)
 {
-    for (trustletSessionIterator_t session = trustletSessions.begin();
-            session != trustletSessions.end();
-            ++session) {
-        TrustletSession *tsTmp = *session;
-        if (tsTmp->sessionId == sessionId) {
-            return tsTmp;
-        }
+    trustletSessionMap_t::iterator found = trustletSessionIndex.find(sessionId);
+    if (found == trustletSessionIndex.end()) {
+        return NULL;
     }
-    return NULL;
+    return *(found->second);
 }
 
 
@@ -91,34 +88,35 @@ void MobiCoreDevice::cleanSessionBuffers(TrustletSession *session)
 //------------------------------------------------------------------------------
 void MobiCoreDevice::removeTrustletSession(uint32_t sessionId)
 {
-    for (trustletSessionIterator_t session = trustletSessions.begin();
-            session != trustletSessions.end();
-            ++session) {
-        if ((*session)->sessionId == sessionId) {
-            cleanSessionBuffers(*session);
-            trustletSessions.erase(session);
-            return;
-        }
+    trustletSessionMap_t::iterator found = trustletSessionIndex.find(sessionId);
+    if (found == trustletSessionIndex.end()) {
+        return;
     }
+
+    cleanSessionBuffers(*(found->second));
+    trustletSessions.erase(found->second);
+    trustletSessionIndex.erase(found);
 }
 //------------------------------------------------------------------------------
-Connection *MobiCoreDevice::getSessionConnection(uint32_t sessionId, notification_t *notification)
+bool MobiCoreDevice::forwardNotification(notification_t *notification)
 {
-    Connection *con = NULL;
     TrustletSession *ts = NULL;
 
-    ts = getTrustletSession(sessionId);
+    ts = getTrustletSession(notification->sessionId);
     if (ts == NULL) {
-        return NULL;
+        return false;
     }
 
-    con = ts->notificationConnection;
-    if (con == NULL) {
+    ts->lock();
+    if (ts->notificationConnection == NULL) {
         ts->queueNotification(notification);
-        return NULL;
+        ts->unlock();
+        return false;
     }
 
-    return con;
+    ts->sendNotification(notification);
+    ts->unlock();
+    return true;
 }
 
 
@@ -345,16 +343,19 @@ mcResult_t MobiCoreDevice::openSession(
         pRspOpenSessionPayload->deviceSessionId = (uint32_t)trustletSession;
         pRspOpenSessionPayload->sessionMagic = trustletSession->sessionMagic;
 
-        trustletSessions.push_back(trustletSession);
+        trustletSessionIndex[trustletSession->sessionId] =
+            trustletSessions.insert(trustletSessions.end(), trustletSession);
 
         trustletSession->addBulkBuff(new CWsm((void *)pLoadDataOpenSession->offs, pLoadDataOpenSession->len, tciHandle, 0));
 
         // We have some queued notifications and we need to send them to them
         // trustlet session
+        trustletSession->lock();
         while (!notifications.empty()) {
             trustletSession->queueNotification(&notifications.front());
             notifications.pop();
         }
+        trustletSession->unlock();
 
     } while (0);
     return MC_DRV_OK;
@@ -362,39 +363,27 @@ mcResult_t MobiCoreDevice::openSession(
 
 
 //------------------------------------------------------------------------------
-TrustletSession *MobiCoreDevice::registerTrustletConnection(
-    Connection                    *connection,
+TrustletSession *MobiCoreDevice::findTrustletConnection(
     MC_DRV_CMD_NQ_CONNECT_struct *cmdNqConnect
 )
 {
-    LOG_I(" Registering notification socket with Service session %d.",
+    LOG_I(" Looking up Service session %d for its notification socket.",
           cmdNqConnect->sessionId);
     LOG_V("  Searching sessionId %d with sessionMagic %d",
           cmdNqConnect->sessionId,
           cmdNqConnect->sessionMagic);
 
-    for (trustletSessionIterator_t iterator = trustletSessions.begin();
-            iterator != trustletSessions.end();
-            ++iterator) {
-        TrustletSession *ts = *iterator;
-
-        if (ts != (TrustletSession *) (cmdNqConnect->deviceSessionId)) {
-            continue;
-        }
-
-        if ( (ts->sessionMagic != cmdNqConnect->sessionMagic)
-                || (ts->sessionId != cmdNqConnect->sessionId)) {
-            continue;
-        }
-
-        ts->notificationConnection = connection;
+    TrustletSession *ts = getTrustletSession(cmdNqConnect->sessionId);
 
-        LOG_I(" Found Service session, registered connection.");
+    if ((ts != NULL)
+            && (ts == (TrustletSession *) (cmdNqConnect->deviceSessionId))
+            && (ts->sessionMagic == cmdNqConnect->sessionMagic)) {
+        LOG_I(" Found Service session.");
 
         return ts;
     }
 
-    LOG_I("registerTrustletConnection(): search failed");
+    LOG_I("findTrustletConnection(): search failed");
     return NULL;
 }
 
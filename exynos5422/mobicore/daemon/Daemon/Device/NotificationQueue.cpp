@@ -31,9 +31,30 @@
  */
 #include "NotificationQueue.h"
 #include <stddef.h>
+#include <string.h>
+#include <sched.h>
 
 #include "log.h"
 
+/** Read a counter which the other side may change at any time. */
+#define READ_ONCE(x)    (*(volatile uint32_t *)&(x))
+
+//------------------------------------------------------------------------------
+/**
+ * Raise a maximum counter, racing with other threads doing the same.
+ */
+static void updateMax(volatile uint32_t *max, uint32_t value)
+{
+    uint32_t old = *max;
+    while (value > old) {
+        if (__sync_bool_compare_and_swap(max, old, value)) {
+            break;
+        }
+        old = *max;
+    }
+}
+
+
 //------------------------------------------------------------------------------
 NotificationQueue::NotificationQueue(
     notificationQueue_t *i,
@@ -43,37 +64,92 @@ NotificationQueue::NotificationQueue(
 {
     in->hdr.queueSize = size;
     out->hdr.queueSize = size;
+    reserveCnt = out->hdr.writeCnt;
+    memset((void *)&stats, 0, sizeof(stats));
 }
 
 
 //------------------------------------------------------------------------------
-void NotificationQueue::putNotification(
+bool NotificationQueue::putNotification(
     notification_t *notification
 )
 {
-    mutex.lock();
-    if ((out->hdr.writeCnt - out->hdr.readCnt) < out->hdr.queueSize) {
-        out->notification[out->hdr.writeCnt & (out->hdr.queueSize - 1)]
-        = *notification;
-        out->hdr.writeCnt++;
+    uint32_t slot;
+
+    // Reserve a slot, unless MobiCore has not consumed enough yet
+    do {
+        slot = reserveCnt;
+        if ((slot - READ_ONCE(out->hdr.readCnt)) >= out->hdr.queueSize) {
+            uint32_t dropped = __sync_add_and_fetch(&stats.overflowCnt, 1);
+            LOG_W("Notification queue full, dropped notification for session %d (%u so far)",
+                  notification->sessionId, dropped);
+            return false;
+        }
+    } while (!__sync_bool_compare_and_swap(&reserveCnt, slot, slot + 1));
+
+    out->notification[slot & (out->hdr.queueSize - 1)] = *notification;
+
+    // MobiCore reads everything below writeCnt, so earlier reservations
+    // have to be published first. Producers only wait for each other
+    // while copying a single element.
+    while (READ_ONCE(out->hdr.writeCnt) != slot) {
+        sched_yield();
     }
-    mutex.unlock();
+    __sync_synchronize();
+    out->hdr.writeCnt = slot + 1;
+
+    __sync_add_and_fetch(&stats.putCnt, 1);
+    updateMax(&stats.maxOutDepth, slot + 1 - READ_ONCE(out->hdr.readCnt));
+    return true;
 }
 
 
 //------------------------------------------------------------------------------
-notification_t *NotificationQueue::getNotification(
-    void
+bool NotificationQueue::getNotification(
+    notification_t *notification
 )
 {
-    notification_t *ret = NULL;
-    mutex.lock();
-    if ((in->hdr.writeCnt - in->hdr.readCnt) > 0) {
-        ret = &(in->notification[in->hdr.readCnt & (in->hdr.queueSize - 1)]);
-        in->hdr.readCnt++;
+    uint32_t readCnt = in->hdr.readCnt;
+    uint32_t depth = READ_ONCE(in->hdr.writeCnt) - readCnt;
+
+    if (depth == 0) {
+        return false;
     }
-    mutex.unlock();
-    return ret;
+    updateMax(&stats.maxInDepth, depth);
+
+    // Element written before writeCnt, copy it before handing the slot back
+    __sync_synchronize();
+    *notification = in->notification[readCnt & (in->hdr.queueSize - 1)];
+    __sync_synchronize();
+    in->hdr.readCnt = readCnt + 1;
+
+    stats.getCnt++;
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+void NotificationQueue::getStatistics(
+    nqStatistics_t *stats
+)
+{
+    stats->putCnt = this->stats.putCnt;
+    stats->getCnt = this->stats.getCnt;
+    stats->overflowCnt = this->stats.overflowCnt;
+    stats->maxOutDepth = this->stats.maxOutDepth;
+    stats->maxInDepth = this->stats.maxInDepth;
+}
+
+
+//------------------------------------------------------------------------------
+void NotificationQueue::logStatistics(
+    void
+)
+{
+    nqStatistics_t s;
+    getStatistics(&s);
+    LOG_I("Notification queue: put=%u get=%u overflow=%u max depth out=%u in=%u",
+          s.putCnt, s.getCnt, s.overflowCnt, s.maxOutDepth, s.maxInDepth);
 }
 
 /** @} */
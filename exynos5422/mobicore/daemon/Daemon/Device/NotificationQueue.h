@@ -4,6 +4,11 @@
  *
  * MobiCore Notification Queue handling.
  *
+ * The outgoing queue takes notifications from any Daemon thread without a
+ * lock: producers reserve a slot with an atomic counter, fill it and then
+ * publish it in reservation order. The incoming queue has the IRQ handler
+ * thread as its only consumer.
+ *
  * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
  *
  * Redistribution and use in source and binary forms, with or without
@@ -35,7 +40,15 @@
 
 #include <inttypes.h> //C99 data
 #include "Mci/mcinq.h"
-#include "CMutex.h"
+
+/** Notification queue counters, all since start-up. */
+typedef struct {
+    uint32_t putCnt; /**< Notifications placed in the outgoing queue */
+    uint32_t getCnt; /**< Notifications taken from the incoming queue */
+    uint32_t overflowCnt; /**< Notifications dropped, outgoing queue full */
+    uint32_t maxOutDepth; /**< Highest outgoing queue fill level seen */
+    uint32_t maxInDepth; /**< Highest incoming queue fill level seen */
+} nqStatistics_t;
 
 
 class NotificationQueue
@@ -58,19 +71,35 @@ public:
     );
 
     /** Places an element to the outgoing queue.
+     * Safe to call from several threads at once.
      *
      * @param notification Data to be placed in queue.
+     * @return false if the queue is full and the notification was dropped.
      */
-    void putNotification(
+    bool putNotification(
         notification_t *notification
     );
 
-    /** Retrieves the first element from the queue.
+    /** Retrieves the first element from the incoming queue.
+     * Must only be called from one thread.
      *
-     * @return first notification Queue element.
-     * @return NULL if the queue is empty.
+     * @param notification Destination of the element.
+     * @return false if the queue is empty.
      */
-    notification_t *getNotification(
+    bool getNotification(
+        notification_t *notification
+    );
+
+    /** Copies the queue counters.
+     *
+     * @param stats Destination of the counters.
+     */
+    void getStatistics(
+        nqStatistics_t *stats
+    );
+
+    /** Prints the queue counters. */
+    void logStatistics(
         void
     );
 
@@ -78,7 +107,8 @@ private:
 
     notificationQueue_t *in;
     notificationQueue_t *out;
-    CMutex mutex;
+    volatile uint32_t reserveCnt; /**< Next outgoing slot to hand out */
+    volatile nqStatistics_t stats;
 
 };
 
@@ -264,6 +264,8 @@ void TrustZoneDevice::notify(
         .payload = 0
     };
 
+    // A full queue is logged by putNotification(), MobiCore is still
+    // kicked below so it drains the queue
     nq->putNotification(&notification);
     //IMPROVEMENT-2012-03-07-maneaval What happens when/if nsiq fails?
     //In the old days an exception would be thrown but it was uncertain
@@ -587,11 +589,9 @@ void TrustZoneDevice::handleIrq(
         LOG_V("S-SIQ received");
 
         // Save all the
-        for (;;) {
-            notification_t *notification = nq->getNotification();
-            if (NULL == notification) {
-                break;
-            }
+        notification_t nqEntry;
+        while (nq->getNotification(&nqEntry)) {
+            notification_t *notification = &nqEntry;
 
             // check if the notification belongs to the MCP session
             if (notification->sessionId == SID_MCP) {
@@ -605,9 +605,9 @@ void TrustZoneDevice::handleIrq(
                 LOG_I(" Found notification for session %d, payload=%d",
                       notification->sessionId, notification->payload);
 
-                // Get the NQ connection for the session ID
-                Connection *connection = getSessionConnection(notification->sessionId, notification);
-                if (connection == NULL) {
+                // Forward session ID and additional payload of
+                // notification to the TLC/Application layer
+                if (!forwardNotification(notification)) {
                     /* Couldn't find the session for this notifications
                      * In practice this only means one thing: there is
                      * a race condition between RTM and the Daemon and
@@ -617,11 +617,7 @@ void TrustZoneDevice::handleIrq(
                     LOG_W("Notification for unknown session ID");
                     queueUnknownNotification(*notification);
                 } else {
-                    LOG_I(" Forward notification to McClient.");
-                    // Forward session ID and additional payload of
-                    // notification to the TLC/Application layer
-                    connection->writeData((void *)notification,
-                                          sizeof(notification_t));
+                    LOG_I(" Forwarded notification to McClient.");
                 }
             }
         }
@@ -630,6 +626,7 @@ void TrustZoneDevice::handleIrq(
         schedSync.signal();
     }
     LOG_E("S-SIQ exception");
+    nq->logStatistics();
     // Tell main thread that "something happened"
     // MSH thread MUST not block!
     DeviceIrqHandler::setExiting();
@@ -31,6 +31,13 @@
 
 #include "TrustletSession.h"
 #include <cstdlib>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <cutils/ashmem.h>
 
 #include "log.h"
 
@@ -41,6 +48,8 @@ TrustletSession::TrustletSession(Connection *deviceConnection, uint32_t sessionI
 {
     this->deviceConnection = deviceConnection;
     this->notificationConnection = NULL;
+    this->notificationRing = NULL;
+    this->ringOverflowed = false;
     this->sessionId = sessionId;
     sessionMagic = rand();
 }
@@ -50,6 +59,7 @@ TrustletSession::TrustletSession(Connection *deviceConnection, uint32_t sessionI
 TrustletSession::~TrustletSession(void)
 {
     map<uint32_t, CWsm_ptr>::iterator it;
+    delete notificationRing;
     delete notificationConnection;
 
     if (!buffers.empty()) {
@@ -77,12 +87,81 @@ void TrustletSession::processQueuedNotifications(void)
     while (!notifications.empty()) {
         // Forward session ID and additional payload of
         // notification to the just established connection
-        notificationConnection->writeData((void *)&notifications.front(),
-                                          sizeof(notification_t));
+        sendNotification(&notifications.front());
         notifications.pop();
     }
 }
 
+//------------------------------------------------------------------------------
+bool TrustletSession::createNotificationRing(void)
+{
+    int memFd = ashmem_create_region("mcNqRing", sizeof(nqRingBuffer_t));
+    if (memFd < 0) {
+        LOG_ERRNO("ashmem_create_region");
+        return false;
+    }
+
+    int eventFd = eventfd(0, 0);
+    if (eventFd < 0) {
+        LOG_ERRNO("eventfd");
+        close(memFd);
+        return false;
+    }
+
+    notificationRing = new NotificationRing(memFd, eventFd);
+    if (!notificationRing->isValid()) {
+        delete notificationRing;
+        notificationRing = NULL;
+        return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void TrustletSession::deleteNotificationRing(void)
+{
+    delete notificationRing;
+    notificationRing = NULL;
+    ringOverflowed = false;
+}
+
+//------------------------------------------------------------------------------
+void TrustletSession::sendNotification(notification_t *notification)
+{
+    // Once the ring has overflowed, later notifications follow the overflow
+    // through the socket. The ring is used again only after the client has
+    // read everything from the socket, so it never sees a newer ring entry
+    // before an older socket one.
+    if ((notificationRing != NULL) && ringOverflowed
+            && isNotificationSocketDrained()) {
+        ringOverflowed = false;
+    }
+
+    if ((notificationRing != NULL) && !ringOverflowed) {
+        if (notificationRing->push((nqRingEntry_t *)notification)) {
+            return;
+        }
+        LOG_W("%s: notification ring of session %u full", __func__, sessionId);
+        ringOverflowed = true;
+    }
+
+    notificationConnection->writeData((void *)notification,
+                                      sizeof(notification_t));
+}
+
+//------------------------------------------------------------------------------
+bool TrustletSession::isNotificationSocketDrained(void)
+{
+    int pending = 0;
+
+    // Bytes the client has not read yet, errors keep using the socket
+    if (ioctl(notificationConnection->socketDescriptor, SIOCOUTQ, &pending) != 0) {
+        LOG_ERRNO("ioctl SIOCOUTQ");
+        return false;
+    }
+    return pending == 0;
+}
+
 //------------------------------------------------------------------------------
 bool TrustletSession::addBulkBuff(CWsm_ptr pWsm)
 {
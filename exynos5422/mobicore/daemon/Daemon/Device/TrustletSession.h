@@ -34,6 +34,8 @@
 #include "NotificationQueue.h"
 #include "CWsm.h"
 #include "Connection.h"
+#include "NotificationRing.h"
+#include "CMutex.h"
 #include <queue>
 #include <map>
 
@@ -43,12 +45,17 @@ class TrustletSession
 private:
     std::queue<notification_t> notifications;
     std::map<uint32_t, CWsm_ptr> buffers;
+    CMutex workLock; /**< Guards the notification connection, ring and queue */
+    bool ringOverflowed; /**< Notifications go through the socket until it is drained */
+
+    bool isNotificationSocketDrained(void);
 
 public:
     uint32_t sessionId;
     uint32_t sessionMagic; // Random data
     Connection *deviceConnection;
     Connection *notificationConnection;
+    NotificationRing *notificationRing; /**< Optional ring, NULL if unused */
 
     TrustletSession(Connection *deviceConnection, uint32_t sessionId);
 
@@ -58,16 +65,50 @@ public:
 
     void processQueuedNotifications(void);
 
+    /**
+     * Create the shared memory ring used for notifications of this session.
+     * @return true if the ring is ready.
+     */
+    bool createNotificationRing(void);
+
+    /**
+     * Drop the ring again, notifications then use the connection only.
+     */
+    void deleteNotificationRing(void);
+
+    /**
+     * Deliver a notification to the client through the ring, or through the
+     * notification connection if there is no ring or it is full. After an
+     * overflow the connection is used until the client has drained it, which
+     * keeps the notifications in order.
+     */
+    void sendNotification(notification_t *notification);
+
     bool addBulkBuff(CWsm_ptr pWsm);
 
     bool removeBulkBuff(uint32_t handle);
 
     CWsm_ptr popBulkBuff();
 
+    /**
+     * Lock the notification state against the IRQ thread.
+     */
+    void lock(void) {
+        workLock.lock();
+    }
+
+    /**
+     * Unlock the notification state.
+     */
+    void unlock(void) {
+        workLock.unlock();
+    }
+
 };
 
 typedef std::list<TrustletSession *> trustletSessionList_t;
 typedef trustletSessionList_t::iterator trustletSessionIterator_t;
+typedef std::map<uint32_t, trustletSessionIterator_t> trustletSessionMap_t;
 
 #endif /* TRUSTLETSESSION_H_ */
 
@@ -83,6 +83,7 @@ protected:
     CSemaphore          mcpSessionNotification; /**< Semaphore to synchronize incoming notifications for the MCP session */
 
     trustletSessionList_t trustletSessions; /**< Available Trustlet Sessions */
+    trustletSessionMap_t trustletSessionIndex; /**< Position in trustletSessions by session ID */
     mcVersionInfo_t     *mcVersionInfo; /**< MobiCore version info. */
     bool                mcFault; /**< Signal RTM fault */
     bool                mciReused; /**< Signal restart of Daemon. */
@@ -122,7 +123,12 @@ public:
     void cleanSessionBuffers(TrustletSession *session);
     void removeTrustletSession(uint32_t sessionId);
 
-    Connection *getSessionConnection(uint32_t sessionId, notification_t *notification);
+    /**
+     * Forward a notification to the client of its session.
+     * @return false if the session is unknown or has no notification
+     * connection yet.
+     */
+    bool forwardNotification(notification_t *notification);
 
     bool open(Connection *connection);
 
@@ -135,8 +141,11 @@ public:
                            uint32_t                        tciOffset,
                            mcDrvRspOpenSessionPayload_ptr  pRspOpenSessionPayload);
 
-    TrustletSession *registerTrustletConnection(Connection *connection,
-            MC_DRV_CMD_NQ_CONNECT_struct  *cmdNqConnect);
+    /**
+     * Find the session a NQ_CONNECT command refers to. The caller attaches
+     * the notification connection with the session locked.
+     */
+    TrustletSession *findTrustletConnection(MC_DRV_CMD_NQ_CONNECT_struct *cmdNqConnect);
 
     // Internal function
     mcResult_t closeSession(uint32_t sessionId);
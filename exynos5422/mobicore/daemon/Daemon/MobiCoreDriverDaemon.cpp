@@ -36,6 +36,7 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "MobiCoreDriverApi.h"
 #include "MobiCoreDriverCmd.h"
@@ -64,6 +65,16 @@ static void checkMobiCoreVersion(MobiCoreDevice *mobiCoreDevice);
 
 #define LOG_I_RELEASE(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 
+/**
+ * Monotonic time in microseconds, for the command trace.
+ */
+static uint64_t getTimeUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 
 //------------------------------------------------------------------------------
 MobiCoreDriverDaemon::MobiCoreDriverDaemon(
@@ -593,7 +604,7 @@ void MobiCoreDriverDaemon::processCloseSession(Connection *connection)
 
 
 //------------------------------------------------------------------------------
-void MobiCoreDriverDaemon::processNqConnect(Connection *connection)
+void MobiCoreDriverDaemon::processNqConnect(Connection *connection, bool useRing)
 {
     // Set up the channel for sending SWd notifications to the client
     // MC_DRV_CMD_NQ_CONNECT is only allowed on new connections not
@@ -625,17 +636,32 @@ void MobiCoreDriverDaemon::processNqConnect(Connection *connection)
         return;
     }
 
-    TrustletSession *ts = device->registerTrustletConnection(
-                              connection,
-                              &cmd);
+    TrustletSession *ts = device->findTrustletConnection(&cmd);
     if (!ts) {
-        LOG_E("registerTrustletConnection() failed!");
+        LOG_E("findTrustletConnection() failed!");
         writeResult(connection, MC_DRV_ERR_UNKNOWN);
         return;
     }
 
-    writeResult(connection, MC_DRV_OK);
+    // The IRQ thread forwards notifications once the connection is set, so
+    // the ring and the reply have to be in place before that
+    ts->lock();
+    if (useRing && ts->createNotificationRing()) {
+        // Hand the ring over together with the result
+        mcResult_t ret = MC_DRV_OK;
+        int fds[2] = { ts->notificationRing->memFd, ts->notificationRing->eventFd };
+        if (connection->writeDataWithFds(&ret, sizeof(ret), fds, 2) != sizeof(ret)) {
+            LOG_E("sending the notification ring of session %d failed", ts->sessionId);
+            ts->deleteNotificationRing();
+        } else {
+            LOG_I(" Notifications of session %d use a shared memory ring.", ts->sessionId);
+        }
+    } else {
+        writeResult(connection, MC_DRV_OK);
+    }
+    ts->notificationConnection = connection;
     ts->processQueuedNotifications();
+    ts->unlock();
 }
 
 
@@ -788,6 +814,37 @@ void MobiCoreDriverDaemon::processGetMobiCoreVersion(
         sizeof(rspGetMobiCoreVersion));
 }
 
+//------------------------------------------------------------------------------
+void MobiCoreDriverDaemon::processGetTrace(
+    Connection  *connection
+)
+{
+    // there is no payload to read
+
+    if (!checkPermission(connection)) {
+        writeResult(connection, MC_DRV_ERR_INVALID_OPERATION);
+        return;
+    }
+
+    mcDrvTraceRecord_t *records = (mcDrvTraceRecord_t *)
+                                  malloc(TRACE_RECORDS * sizeof(mcDrvTraceRecord_t));
+    if (records == NULL) {
+        writeResult(connection, MC_DRV_ERR_NO_FREE_MEMORY);
+        return;
+    }
+
+    mcDrvRspGetTrace_t rspGetTrace;
+    rspGetTrace.header.responseId = MC_DRV_OK;
+    rspGetTrace.numRecords = commandTrace.copyRecords(records);
+
+    commandTrace.logHistograms();
+
+    if (connection->writeData(&rspGetTrace, sizeof(rspGetTrace)) == sizeof(rspGetTrace)) {
+        connection->writeData(records, rspGetTrace.numRecords * sizeof(mcDrvTraceRecord_t));
+    }
+    free(records);
+}
+
 //------------------------------------------------------------------------------
 void MobiCoreDriverDaemon::processRegistryReadData(uint32_t commandId, Connection  *connection)
 {
@@ -953,14 +1010,25 @@ bool MobiCoreDriverDaemon::handleConnection(
         return false;
     }
 
+    uint64_t enterUs = getTimeUs();
     mutex.lock();
+    uint64_t lockedUs = getTimeUs();
     LOG_I("handleConnection()==== %p", connection);
+
+    mcDrvTraceRecord_t trace;
+    trace.commandId = 0;
+    trace.queueUs = (uint32_t)(lockedUs - enterUs);
+    uint32_t bytesRead = connection->bytesRead;
+    uint32_t bytesWritten = connection->bytesWritten;
+    uint64_t startUs = 0;
+
     do {
         // Read header
         mcDrvCommandHeader_t mcDrvCommandHeader;
         ssize_t rlen = connection->readData(
                            &(mcDrvCommandHeader),
                            sizeof(mcDrvCommandHeader));
+        startUs = getTimeUs();
 
         if (rlen == 0) {
             LOG_V(" handleConnection(): Connection closed.");
@@ -975,6 +1043,7 @@ bool MobiCoreDriverDaemon::handleConnection(
             break;
         }
         ret = true;
+        trace.commandId = mcDrvCommandHeader.commandId;
 
         switch (mcDrvCommandHeader.commandId) {
             //-----------------------------------------
@@ -999,7 +1068,11 @@ bool MobiCoreDriverDaemon::handleConnection(
             break;
             //-----------------------------------------
         case MC_DRV_CMD_NQ_CONNECT:
-            processNqConnect(connection);
+            processNqConnect(connection, false);
+            break;
+            //-----------------------------------------
+        case MC_DRV_CMD_NQ_CONNECT_RING:
+            processNqConnect(connection, true);
             break;
             //-----------------------------------------
         case MC_DRV_CMD_NOTIFY:
@@ -1022,6 +1095,10 @@ bool MobiCoreDriverDaemon::handleConnection(
             processGetMobiCoreVersion(connection);
             break;
             //-----------------------------------------
+        case MC_DRV_CMD_GET_TRACE:
+            processGetTrace(connection);
+            break;
+            //-----------------------------------------
         /* Registry functionality */
         // Write Registry Data
         case MC_DRV_REG_STORE_AUTH_TOKEN:
@@ -1056,6 +1133,14 @@ bool MobiCoreDriverDaemon::handleConnection(
             break;
         }
     } while (0);
+
+    // Only commands the Daemon actually took are worth keeping
+    if (ret) {
+        trace.latencyUs = (uint32_t)(getTimeUs() - startUs);
+        trace.bytesIn = connection->bytesRead - bytesRead;
+        trace.bytesOut = connection->bytesWritten - bytesWritten;
+        commandTrace.record(&trace);
+    }
     mutex.unlock();
     LOG_I("handleConnection()<-------");
 
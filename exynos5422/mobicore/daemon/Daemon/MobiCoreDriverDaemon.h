@@ -38,6 +38,7 @@
 #include "Server/public/Server.h"
 
 #include "MobiCoreDevice.h"
+#include "CommandTrace.h"
 #include <string>
 #include <list>
 
@@ -113,6 +114,8 @@ private:
     driverResourcesList_t driverResources;
     /**< List of servers processing connections */
     Server *servers[MAX_SERVERS];
+    /**< Timing of handled commands, guarded by the command lock */
+    CommandTrace commandTrace;
 
     bool checkPermission(Connection *connection);
 
@@ -164,8 +167,9 @@ private:
      * NQ Connect command
      *
      * @param connection Connection object
+     * @param useRing Set up a shared memory notification ring as well
      */
-    void processNqConnect(Connection *connection);
+    void processNqConnect(Connection *connection, bool useRing);
 
     /**
      * Close Device command
@@ -216,6 +220,13 @@ private:
      */
     void processGetMobiCoreVersion(Connection *connection);
 
+    /**
+     * Get command trace command
+     *
+     * @param connection Connection object
+     */
+    void processGetTrace(Connection *connection);
+
     /**
      * Generic Registry read command
      *
@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/epoll.h>
 
 //#define LOG_VERBOSE
 #include "log.h"
@@ -47,6 +48,8 @@ Server::Server(
 ) : socketAddr(localAddr)
 {
     this->connectionHandler = connectionHandler;
+    serverSock = -1;
+    epollFd = -1;
 }
 
 
@@ -85,55 +88,53 @@ void Server::run(
 
         LOG_I("\n********* successfully initialized Daemon *********\n");
 
+        // The server socket is registered with a NULL pointer, every peer
+        // socket with its Connection object
+        epollFd = epoll_create(LISTEN_QUEUE_LEN);
+        if (epollFd < 0) {
+            LOG_ERRNO("epoll_create");
+            break;
+        }
+
+        struct epoll_event serverEvent;
+        serverEvent.events = EPOLLIN;
+        serverEvent.data.ptr = NULL;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, serverSock, &serverEvent) < 0) {
+            LOG_ERRNO("epoll_ctl");
+            break;
+        }
+
         for (;;) {
-            fd_set fdReadSockets;
-
-            // Clear FD for select()
-            FD_ZERO(&fdReadSockets);
-
-            // Select server socket descriptor
-            FD_SET(serverSock, &fdReadSockets);
-            int maxSocketDescriptor = serverSock;
-
-            // Select socket descriptor of all connections
-            for (connectionIterator_t iterator = peerConnections.begin();
-                    iterator != peerConnections.end();
-                    ++iterator) {
-                Connection *connection = (*iterator);
-                int peerSocket = connection->socketDescriptor;
-                FD_SET(peerSocket, &fdReadSockets);
-                if (peerSocket > maxSocketDescriptor) {
-                    maxSocketDescriptor = peerSocket;
-                }
-            }
+            struct epoll_event events[MAX_EPOLL_EVENTS];
 
-            // Wait for activities, select() returns the number of sockets
+            // Wait for activities, epoll_wait() returns the number of sockets
             // which require processing
             LOG_V(" Server: waiting on sockets");
-            int numSockets = select(
-                                 maxSocketDescriptor + 1,
-                                 &fdReadSockets,
-                                 NULL, NULL, NULL);
+            int numSockets = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, -1);
 
-            // Check if select failed
+            // Check if epoll_wait failed
             if (numSockets < 0) {
-                LOG_ERRNO("select");
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERRNO("epoll_wait");
                 break;
             }
 
             // actually, this should not happen.
             if (0 == numSockets) {
-                LOG_W(" Server: select() returned 0, spurious event?.");
+                LOG_W(" Server: epoll_wait() returned 0, spurious event?.");
                 continue;
             }
 
             LOG_V(" Server: events on %d socket(s).", numSockets);
 
-            // Check if a new client connected to the server socket
-            if (FD_ISSET(serverSock, &fdReadSockets)) {
-                do {
+            for (int i = 0; i < numSockets; i++) {
+                Connection *connection = (Connection *)events[i].data.ptr;
+
+                // Check if a new client connected to the server socket
+                if (connection == NULL) {
                     LOG_V(" Server: new connection attempt.");
-                    numSockets--;
 
                     struct sockaddr_un clientAddr;
                     socklen_t clientSockLen = sizeof(clientAddr);
@@ -142,37 +143,32 @@ void Server::run(
                                          (struct sockaddr *) &clientAddr,
                                          &clientSockLen);
 
+                    // we can ignore any errors from accepting a new connection.
+                    // If this fail, the client has to deal with it, we are done
+                    // and nothing has changed.
                     if (clientSock <= 0) {
                         LOG_ERRNO("accept");
-                        break;
+                        continue;
                     }
 
-                    Connection *connection = new Connection(clientSock, &clientAddr);
-                    peerConnections.push_back(connection);
-                    LOG_I(" Server: new socket connection established and start listening.");
-                } while (false);
-
-                // we can ignore any errors from accepting a new connection.
-                // If this fail, the client has to deal with it, we are done
-                // and nothing has changed.
-            }
+                    connection = new Connection(clientSock, &clientAddr);
 
-            // Handle traffic on existing client connections
-            connectionIterator_t iterator = peerConnections.begin();
-            while ( (iterator != peerConnections.end())
-                    && (numSockets > 0) ) {
-                Connection *connection = (*iterator);
-                int peerSocket = connection->socketDescriptor;
+                    struct epoll_event peerEvent;
+                    peerEvent.events = EPOLLIN;
+                    peerEvent.data.ptr = connection;
+                    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, clientSock, &peerEvent) < 0) {
+                        LOG_ERRNO("epoll_ctl");
+                        delete connection;
+                        continue;
+                    }
 
-                if (!FD_ISSET(peerSocket, &fdReadSockets)) {
-                    ++iterator;
+                    peerConnections.push_back(connection);
+                    LOG_I(" Server: new socket connection established and start listening.");
                     continue;
                 }
 
-                numSockets--;
-
-                // the connection will be terminated if command processing
-                // fails
+                // Handle traffic on an existing client connection, the
+                // connection will be terminated if command processing fails
                 if (!connectionHandler->handleConnection(connection)) {
                     LOG_I(" Server: dropping connection.");
 
@@ -180,12 +176,9 @@ void Server::run(
                     connectionHandler->dropConnection(connection);
 
                     // Remove connection from list
+                    removeConnection(connection);
                     delete connection;
-                    iterator = peerConnections.erase(iterator);
-                    continue;
                 }
-
-                ++iterator;
             }
         }
 
@@ -202,16 +195,28 @@ void Server::detachConnection(
 {
     LOG_V(" Stopping to listen on notification socket.");
 
+    if (removeConnection(connection)) {
+        LOG_I(" Stopped listening on notification socket.");
+    }
+}
+
+
+//------------------------------------------------------------------------------
+bool Server::removeConnection(
+    Connection *connection
+)
+{
     for (connectionIterator_t iterator = peerConnections.begin();
             iterator != peerConnections.end();
             ++iterator) {
         Connection *tmpConnection = (*iterator);
         if (tmpConnection == connection) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->socketDescriptor, NULL);
             peerConnections.erase(iterator);
-            LOG_I(" Stopped listening on notification socket.");
-            break;
+            return true;
         }
     }
+    return false;
 }
 
 
@@ -222,6 +227,9 @@ Server::~Server(
 {
     // Shut down the server socket
     close(serverSock);
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
 
     // Destroy all client connections
     connectionIterator_t iterator = peerConnections.begin();
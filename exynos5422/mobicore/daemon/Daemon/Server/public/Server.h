@@ -50,6 +50,9 @@
  * Additional clients will generate the error ECONNREFUSED. */
 #define LISTEN_QUEUE_LEN    (16)
 
+/** Number of ready sockets fetched from epoll per wakeup. */
+#define MAX_EPOLL_EVENTS    (16)
+
 
 class Server: public CThread
 {
@@ -95,12 +98,21 @@ public:
 
 protected:
     int serverSock;
+    int epollFd; /**< Watches the server socket and all peer connections */
     string socketAddr;
     ConnectionHandler   *connectionHandler; /**< Connection handler registered to the server */
 
 private:
     connectionList_t    peerConnections; /**< Connections to devices */
 
+    /**
+     * Remove a connection from the list and stop watching its socket.
+     * @return true if the connection was one of ours.
+     */
+    bool removeConnection(
+        Connection *connection
+    );
+
 };
 
 #endif /* SERVER_H_ */
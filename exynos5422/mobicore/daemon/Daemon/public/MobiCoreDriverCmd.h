@@ -52,6 +52,8 @@ typedef enum {
     MC_DRV_CMD_GET_VERSION          = 10,
     MC_DRV_CMD_GET_MOBICORE_VERSION = 11,
     MC_DRV_CMD_OPEN_TRUSTLET        = 12,
+    MC_DRV_CMD_NQ_CONNECT_RING      = 13,
+    MC_DRV_CMD_GET_TRACE            = 14,
 
     // Registry Commands
 
@@ -215,6 +217,11 @@ typedef struct {
     mcDrvResponseHeader_t       header;
 } mcDrvRspNqConnect_t;
 
+/** Like MC_DRV_CMD_NQ_CONNECT, but asks for a shared memory notification
+ * ring. On success the response carries the ring memory and eventfd
+ * descriptors, unless the Daemon could not set the ring up. */
+typedef struct MC_DRV_CMD_NQ_CONNECT_struct MC_DRV_CMD_NQ_CONNECT_RING_struct;
+
 //--------------------------------------------------------------
 struct MC_DRV_CMD_GET_VERSION_struct {
     uint32_t commandId;
@@ -239,6 +246,26 @@ typedef struct {
     mcDrvRspGetMobiCoreVersionPayload_t payload;
 } mcDrvRspGetMobiCoreVersion_t;
 
+//--------------------------------------------------------------
+struct MC_DRV_CMD_GET_TRACE_struct {
+    uint32_t commandId;
+};
+
+/** One handled command as recorded by the Daemon. */
+typedef struct {
+    uint32_t commandId;
+    uint32_t queueUs;   /**< Time spent waiting for the command lock */
+    uint32_t latencyUs; /**< Time from header read to response sent */
+    uint32_t bytesIn;   /**< Payload bytes read, including the header */
+    uint32_t bytesOut;  /**< Payload bytes written */
+} mcDrvTraceRecord_t;
+
+/** The response is followed by numRecords mcDrvTraceRecord_t, oldest first. */
+typedef struct {
+    mcDrvResponseHeader_t header;
+    uint32_t              numRecords;
+} mcDrvRspGetTrace_t;
+
 //--------------------------------------------------------------
 typedef union {
     mcDrvCommandHeader_t                header;
@@ -253,6 +280,7 @@ typedef union {
     MC_DRV_CMD_UNMAP_BULK_BUF_struct    mcDrvCmdUnmapBulkMem;
     MC_DRV_CMD_GET_VERSION_struct       mcDrvCmdGetVersion;
     MC_DRV_CMD_GET_MOBICORE_VERSION_struct  mcDrvCmdGetMobiCoreVersion;
+    MC_DRV_CMD_GET_TRACE_struct         mcDrvCmdGetTrace;
 } mcDrvCommand_t, *mcDrvCommand_ptr;
 
 typedef union {
@@ -266,6 +294,7 @@ typedef union {
     mcDrvRspUnmapBulkMem_t       mcDrvRspUnmapBulkMem;
     mcDrvRspGetVersion_t         mcDrvRspGetVersion;
     mcDrvRspGetMobiCoreVersion_t mcDrvRspGetMobiCoreVersion;
+    mcDrvRspGetTrace_t           mcDrvRspGetTrace;
 } mcDrvResponse_t, *mcDrvResponse_ptr;
 
 #endif /* MCDAEMON_H_ */
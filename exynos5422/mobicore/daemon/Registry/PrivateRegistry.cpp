@@ -40,6 +40,7 @@
 #include <assert.h>
 #include <string.h>
 #include <string>
+#include <list>
 #include <cstring>
 #include <cstddef>
 #include <sys/mman.h>
@@ -52,6 +53,7 @@
 
 #include "PrivateRegistry.h"
 #include "MobiCoreRegistry.h"
+#include "CMutex.h"
 
 #include "log.h"
 
@@ -59,6 +61,8 @@
 #define MAX_TL_SIZE       (1 * 1024 * 1024)
 /** Maximum size of a shared object container in bytes. */
 #define MAX_SO_CONT_SIZE  (512)
+/** Default memory ceiling of the service blob cache in bytes. */
+#define BLOB_CACHE_DEFAULT_SIZE  (4 * 1024 * 1024)
 
 // Asserts expression at compile-time (to be used within a function body).
 #define ASSERT_STATIC(e) do { enum { assert_static__ = 1 / (e) }; } while (0)
@@ -76,6 +80,26 @@ static const string TL_BIN_FILE_EXT = ".tlbin";
 static const string DATA_CONT_FILE_EXT = ".datacont";
 
 static const string ENV_MC_AUTH_TOKEN_PATH = "MC_AUTH_TOKEN_PATH";
+static const string ENV_MC_BLOB_CACHE_SIZE = "MC_BLOB_CACHE_SIZE";
+
+/** Validated service blob loaded from a trustlet binary in the registry. */
+typedef struct {
+    mcUuid_t uuid;
+    time_t mtime; /**< Modification time of the trustlet file */
+    off_t fileSize; /**< Size of the trustlet file */
+    regObject_t *regobj;
+} blobCacheEntry_t;
+
+typedef list<blobCacheEntry_t> blobCacheList_t;
+typedef blobCacheList_t::iterator blobCacheIterator_t;
+
+/** Service blob cache, most recently used entry first. */
+static blobCacheList_t blobCache;
+static size_t blobCacheBytes = 0;
+static size_t blobCacheLimit = (size_t) - 1; /**< Read from the environment on first use */
+static uint32_t blobCacheHits = 0;
+static uint32_t blobCacheMisses = 0;
+static CMutex blobCacheMutex;
 
 //------------------------------------------------------------------------------
 static string byteArrayToString(const void *bytes, size_t elems)
@@ -806,9 +830,8 @@ regObject_t *mcRegistryMemGetServiceBlob(mcSpid_t spid, void *trustlet, uint32_t
 
 
 //------------------------------------------------------------------------------
-regObject_t *mcRegistryFileGetServiceBlob(const char* trustlet)
+static regObject_t *loadServiceBlobFile(const char *trustlet, struct stat *sb)
 {
-    struct stat sb;
     regObject_t *regobj = NULL;
     void *buffer;
 
@@ -824,21 +847,21 @@ regObject_t *mcRegistryFileGetServiceBlob(const char* trustlet)
         return NULL;
     }
 
-    if (fstat(fd, &sb) == -1){
+    if (fstat(fd, sb) == -1){
         LOG_E("mcRegistryGetServiceBlob() failed: Cound't get file size");
         goto error;
     }
 
-    buffer = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    buffer = mmap(NULL, sb->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
     if (buffer == MAP_FAILED) {
         LOG_E("mcRegistryGetServiceBlob(): Failed to map file to memory");
         goto error;
     }
 
-    regobj = mcRegistryMemGetServiceBlob(0, buffer, sb.st_size);
+    regobj = mcRegistryMemGetServiceBlob(0, buffer, sb->st_size);
 
     // We don't actually care if either of them fails but should still print warnings
-    if (munmap(buffer, sb.st_size)) {
+    if (munmap(buffer, sb->st_size)) {
         LOG_E("mcRegistryGetServiceBlob(): Failed to unmap memory");
     }
 
@@ -851,6 +874,125 @@ error:
 }
 
 
+//------------------------------------------------------------------------------
+regObject_t *mcRegistryFileGetServiceBlob(const char* trustlet)
+{
+    struct stat sb;
+
+    return loadServiceBlobFile(trustlet, &sb);
+}
+
+
+//------------------------------------------------------------------------------
+static regObject_t *copyRegObject(const regObject_t *regobj)
+{
+    size_t size = sizeof(regObject_t) + regobj->len;
+    regObject_t *copy = (regObject_t *) malloc(size);
+    if (copy == NULL) {
+        LOG_E("mcRegistryGetServiceBlob() failed: Out of memory");
+        return NULL;
+    }
+    memcpy(copy, regobj, size);
+    return copy;
+}
+
+
+//------------------------------------------------------------------------------
+static void blobCacheErase(blobCacheIterator_t iterator)
+{
+    blobCacheBytes -= sizeof(regObject_t) + iterator->regobj->len;
+    free(iterator->regobj);
+    blobCache.erase(iterator);
+}
+
+
+//------------------------------------------------------------------------------
+static size_t blobCacheGetLimit(void)
+{
+    if (blobCacheLimit == (size_t) - 1) {
+        const char *size = getenv(ENV_MC_BLOB_CACHE_SIZE.c_str());
+        blobCacheLimit = BLOB_CACHE_DEFAULT_SIZE;
+        if (size != NULL) {
+            blobCacheLimit = strtoul(size, NULL, 0);
+        }
+        LOG_I(" Service blob cache limited to %u bytes", blobCacheLimit);
+    }
+    return blobCacheLimit;
+}
+
+
+//------------------------------------------------------------------------------
+/**
+ * Look up a cached blob for uuid. Entries whose trustlet file changed or
+ * disappeared since they were loaded are dropped.
+ * @return a copy of the cached blob, NULL on a miss.
+ */
+static regObject_t *blobCacheLookup(const mcUuid_t *uuid, const struct stat *sb)
+{
+    for (blobCacheIterator_t iterator = blobCache.begin();
+            iterator != blobCache.end();
+            ++iterator) {
+        if (memcmp(&iterator->uuid, uuid, sizeof(mcUuid_t)) != 0) {
+            continue;
+        }
+
+        if (sb == NULL
+                || iterator->mtime != sb->st_mtime
+                || iterator->fileSize != sb->st_size) {
+            LOG_I(" Service blob cache: dropping stale entry");
+            blobCacheErase(iterator);
+            return NULL;
+        }
+
+        // Move the entry to the front of the LRU list
+        blobCache.splice(blobCache.begin(), blobCache, iterator);
+        return copyRegObject(blobCache.front().regobj);
+    }
+    return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+static void blobCacheInsert(const mcUuid_t *uuid, const struct stat *sb, const regObject_t *regobj)
+{
+    // Only blobs taken 'as is' from the file are cached. SP trustlet blobs
+    // embed containers which can be changed through the registry.
+    mclfHeaderV2_t *pHeader = (mclfHeaderV2_t *)regobj->value;
+    if (regobj->tlStartOffset != 0
+            || (pHeader->serviceType != SERVICE_TYPE_DRIVER
+                && pHeader->serviceType != SERVICE_TYPE_SYSTEM_TRUSTLET)) {
+        return;
+    }
+
+    size_t size = sizeof(regObject_t) + regobj->len;
+    size_t limit = blobCacheGetLimit();
+    if (size > limit) {
+        return;
+    }
+
+    blobCacheEntry_t entry;
+    entry.regobj = copyRegObject(regobj);
+    if (entry.regobj == NULL) {
+        return;
+    }
+    memcpy(&entry.uuid, uuid, sizeof(mcUuid_t));
+    entry.mtime = sb->st_mtime;
+    entry.fileSize = sb->st_size;
+
+    // Evict least recently used entries until the new one fits
+    if (blobCacheBytes + size > limit) {
+        while (blobCacheBytes + size > limit) {
+            blobCacheErase(--blobCache.end());
+        }
+        LOG_I(" Service blob cache full: %u hits, %u misses, %u bytes in %u entries left",
+              blobCacheHits, blobCacheMisses, blobCacheBytes, blobCache.size());
+    }
+
+    blobCache.push_front(entry);
+    blobCacheBytes += size;
+}
+
+
 //------------------------------------------------------------------------------
 regObject_t *mcRegistryGetServiceBlob(const mcUuid_t *uuid)
 {
@@ -864,7 +1006,33 @@ regObject_t *mcRegistryGetServiceBlob(const mcUuid_t *uuid)
     string tlBinFilePath = getTlBinFilePath(uuid);
     LOG_I(" Loading %s", tlBinFilePath.c_str());
 
-    return mcRegistryFileGetServiceBlob(tlBinFilePath.c_str());
+    struct stat sb;
+    bool fileExists = (stat(tlBinFilePath.c_str(), &sb) == 0);
+
+    blobCacheMutex.lock();
+    regObject_t *regobj = blobCacheLookup(uuid, fileExists ? &sb : NULL);
+    if (regobj != NULL) {
+        blobCacheHits++;
+    } else {
+        blobCacheMisses++;
+    }
+    LOG_V(" Service blob cache %s: %u hits, %u misses, %u bytes in %u entries",
+          regobj != NULL ? "hit" : "miss", blobCacheHits, blobCacheMisses,
+          blobCacheBytes, blobCache.size());
+    blobCacheMutex.unlock();
+
+    if (regobj != NULL) {
+        return regobj;
+    }
+
+    regobj = loadServiceBlobFile(tlBinFilePath.c_str(), &sb);
+    if (regobj != NULL && regobj->len != 0) {
+        blobCacheMutex.lock();
+        blobCacheInsert(uuid, &sb, regobj);
+        blobCacheMutex.unlock();
+    }
+
+    return regobj;
 }
 
 //------------------------------------------------------------------------------
@@ -28,15 +28,19 @@
 #include <string.h>
 #include <dlfcn.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
 #include <assert.h>
 #include <dirent.h>
+#include <cutils/properties.h>
 
 #include "OMX_Component.h"
 #include "Exynos_OSAL_Memory.h"
 #include "Exynos_OSAL_ETC.h"
 #include "Exynos_OSAL_Library.h"
+#include "Exynos_OSAL_Mutex.h"
 #include "Exynos_OMX_Component_Register.h"
 #include "Exynos_OMX_Macros.h"
 
@@ -44,23 +48,168 @@
 #define EXYNOS_LOG_TAG    "EXYNOS_COMP_REGS"
 #include "Exynos_OSAL_Log.h"
 
+static EXYNOS_OMX_COMPONENT_LIBRARY *gComponentLibraryList = NULL;
+static OMX_HANDLETYPE                ghComponentLibraryMutex = NULL;
+
+static void Exynos_OMX_Registry_GetFingerprint(OMX_U8 *fingerprint)
+{
+    char value[PROPERTY_VALUE_MAX];
+
+    Exynos_OSAL_Memset(fingerprint, 0, EXYNOS_OMX_REGISTRY_FINGERPRINT_SIZE);
+    property_get("ro.build.fingerprint", value, "");
+    Exynos_OSAL_Memcpy(fingerprint, value, Exynos_OSAL_Strlen(value));
+}
+
+static OMX_ERRORTYPE Exynos_OMX_Registry_Load(
+    EXYNOS_OMX_COMPONENT_REGLIST *componentList,
+    int                          *compNum,
+    EXYNOS_OMX_REGISTRY_LIBINFO  *libInfo,
+    int                           libNum)
+{
+    OMX_ERRORTYPE                ret = OMX_ErrorUndefined;
+    EXYNOS_OMX_REGISTRY_HEADER   header;
+    EXYNOS_OMX_REGISTRY_LIBINFO  cachedInfo;
+    OMX_U8                       fingerprint[EXYNOS_OMX_REGISTRY_FINGERPRINT_SIZE];
+    FILE                        *fp;
+    int                          i, j;
+
+    Exynos_OMX_Registry_GetFingerprint(fingerprint);
+
+    fp = fopen(EXYNOS_OMX_REGISTRY_CACHE_PATH, "rb");
+    if (fp == NULL)
+        goto EXIT;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1)
+        goto CLOSE;
+
+    if ((header.magic != EXYNOS_OMX_REGISTRY_MAGIC) ||
+        (header.version != EXYNOS_OMX_REGISTRY_VERSION) ||
+        (header.recordSize != sizeof(EXYNOS_OMX_COMPONENT_REGLIST)) ||
+        (header.libNum != (OMX_U32)libNum) ||
+        (header.compNum > MAX_OMX_COMPONENT_NUM) ||
+        (memcmp(header.buildFingerprint, fingerprint, sizeof(fingerprint)) != 0)) {
+        Exynos_OSAL_Log(EXYNOS_LOG_INFO, "registry cache header mismatch");
+        goto CLOSE;
+    }
+
+    /* every installed library must be in the cache unchanged */
+    for (i = 0; i < libNum; i++) {
+        if (fread(&cachedInfo, sizeof(cachedInfo), 1, fp) != 1)
+            goto CLOSE;
+
+        for (j = 0; j < libNum; j++) {
+            if (Exynos_OSAL_Strcmp(cachedInfo.libName, libInfo[j].libName) == 0)
+                break;
+        }
+        if ((j == libNum) ||
+            (cachedInfo.mtime != libInfo[j].mtime) ||
+            (cachedInfo.size != libInfo[j].size)) {
+            Exynos_OSAL_Log(EXYNOS_LOG_INFO, "registry cache stale: %s", cachedInfo.libName);
+            goto CLOSE;
+        }
+    }
+
+    if (fread(componentList, sizeof(EXYNOS_OMX_COMPONENT_REGLIST), header.compNum, fp) != header.compNum)
+        goto CLOSE;
+
+    for (i = 0; i < (int)header.compNum; i++) {
+        componentList[i].component.componentName[MAX_OMX_COMPONENT_NAME_SIZE - 1] = '\0';
+        componentList[i].libName[MAX_OMX_COMPONENT_LIBNAME_SIZE - 1] = '\0';
+        if (componentList[i].component.totalRoleNum > MAX_OMX_COMPONENT_ROLE_NUM)
+            goto CLOSE;
+        for (j = 0; j < (int)componentList[i].component.totalRoleNum; j++)
+            componentList[i].component.roles[j][MAX_OMX_COMPONENT_ROLE_SIZE - 1] = '\0';
+
+        /* only libraries just found installed may be dlopened later */
+        for (j = 0; j < libNum; j++) {
+            if (Exynos_OSAL_Strcmp(componentList[i].libName, libInfo[j].libName) == 0)
+                break;
+        }
+        if (j == libNum) {
+            Exynos_OSAL_Log(EXYNOS_LOG_INFO, "registry cache names unknown library: %s", componentList[i].libName);
+            goto CLOSE;
+        }
+    }
+
+    *compNum = header.compNum;
+    ret = OMX_ErrorNone;
+
+CLOSE:
+    fclose(fp);
+
+    if (ret != OMX_ErrorNone)
+        Exynos_OSAL_Memset(componentList, 0, sizeof(EXYNOS_OMX_COMPONENT_REGLIST) * MAX_OMX_COMPONENT_NUM);
+
+EXIT:
+    return ret;
+}
+
+static void Exynos_OMX_Registry_Save(
+    EXYNOS_OMX_COMPONENT_REGLIST *componentList,
+    int                           compNum,
+    EXYNOS_OMX_REGISTRY_LIBINFO  *libInfo,
+    int                           libNum)
+{
+    EXYNOS_OMX_REGISTRY_HEADER  header;
+    char                        tmpPath[] = EXYNOS_OMX_REGISTRY_CACHE_PATH ".tmp";
+    FILE                       *fp;
+    int                         err = 0;
+
+    header.magic      = EXYNOS_OMX_REGISTRY_MAGIC;
+    header.version    = EXYNOS_OMX_REGISTRY_VERSION;
+    header.recordSize = sizeof(EXYNOS_OMX_COMPONENT_REGLIST);
+    header.libNum     = libNum;
+    header.compNum    = compNum;
+    Exynos_OMX_Registry_GetFingerprint(header.buildFingerprint);
+
+    /* write aside and rename, a reader never sees a partial cache */
+    fp = fopen(tmpPath, "wb");
+    if (fp == NULL) {
+        Exynos_OSAL_Log(EXYNOS_LOG_INFO, "registry cache not writable: %s", strerror(errno));
+        return;
+    }
+
+    if ((fwrite(&header, sizeof(header), 1, fp) != 1) ||
+        (fwrite(libInfo, sizeof(EXYNOS_OMX_REGISTRY_LIBINFO), libNum, fp) != (size_t)libNum) ||
+        (fwrite(componentList, sizeof(EXYNOS_OMX_COMPONENT_REGLIST), compNum, fp) != (size_t)compNum))
+        err = 1;
+
+    if (fclose(fp) != 0)
+        err = 1;
+
+    if ((err != 0) || (rename(tmpPath, EXYNOS_OMX_REGISTRY_CACHE_PATH) != 0)) {
+        Exynos_OSAL_Log(EXYNOS_LOG_WARNING, "registry cache write failed");
+        unlink(tmpPath);
+    }
+}
+
 OMX_ERRORTYPE Exynos_OMX_Component_Register(EXYNOS_OMX_COMPONENT_REGLIST **compList, OMX_U32 *compNum)
 {
     OMX_ERRORTYPE  ret = OMX_ErrorNone;
     int            componentNum = 0, roleNum = 0, totalCompNum = 0;
+    int            libNum = 0;
+    OMX_BOOL       bCacheable = OMX_TRUE;
     int            read;
     char          *libName;
     size_t         len;
     const char    *errorMsg;
     DIR           *dir;
     struct dirent *d;
+    struct stat    libStat;
 
     int (*Exynos_OMX_COMPONENT_Library_Register)(ExynosRegisterComponentType **exynosComponents);
     ExynosRegisterComponentType **exynosComponentsTemp;
     EXYNOS_OMX_COMPONENT_REGLIST *componentList;
+    EXYNOS_OMX_REGISTRY_LIBINFO  *libInfo;
 
     FunctionIn();
 
+    if ((ghComponentLibraryMutex == NULL) &&
+        (Exynos_OSAL_MutexCreate(&ghComponentLibraryMutex) != OMX_ErrorNone)) {
+        ret = OMX_ErrorInsufficientResources;
+        goto EXIT;
+    }
+
     dir = opendir(EXYNOS_OMX_INSTALL_PATH);
     if (dir == NULL) {
         ret = OMX_ErrorUndefined;
@@ -69,8 +218,41 @@ OMX_ERRORTYPE Exynos_OMX_Component_Register(EXYNOS_OMX_COMPONENT_REGLIST **compL
 
     componentList = (EXYNOS_OMX_COMPONENT_REGLIST *)Exynos_OSAL_Malloc(sizeof(EXYNOS_OMX_COMPONENT_REGLIST) * MAX_OMX_COMPONENT_NUM);
     Exynos_OSAL_Memset(componentList, 0, sizeof(EXYNOS_OMX_COMPONENT_REGLIST) * MAX_OMX_COMPONENT_NUM);
+    libInfo = (EXYNOS_OMX_REGISTRY_LIBINFO *)Exynos_OSAL_Malloc(sizeof(EXYNOS_OMX_REGISTRY_LIBINFO) * MAX_OMX_COMPONENT_NUM);
+    Exynos_OSAL_Memset(libInfo, 0, sizeof(EXYNOS_OMX_REGISTRY_LIBINFO) * MAX_OMX_COMPONENT_NUM);
     libName = Exynos_OSAL_Malloc(MAX_OMX_COMPONENT_LIBNAME_SIZE);
 
+    /* fingerprint the installed libraries, stat is much cheaper than dlopen */
+    while ((d = readdir(dir)) != NULL) {
+        if (Exynos_OSAL_Strncmp(d->d_name, "libOMX.Exynos.", Exynos_OSAL_Strlen("libOMX.Exynos.")) != 0)
+            continue;
+
+        if (libNum == MAX_OMX_COMPONENT_NUM) {
+            bCacheable = OMX_FALSE;
+            break;
+        }
+
+        Exynos_OSAL_Memset(libName, 0, MAX_OMX_COMPONENT_LIBNAME_SIZE);
+        Exynos_OSAL_Strcpy(libName, EXYNOS_OMX_INSTALL_PATH);
+        Exynos_OSAL_Strcat(libName, d->d_name);
+        if (stat(libName, &libStat) != 0) {
+            bCacheable = OMX_FALSE;
+            continue;
+        }
+
+        Exynos_OSAL_Strcpy(libInfo[libNum].libName, libName);
+        libInfo[libNum].mtime = (OMX_S64)libStat.st_mtime;
+        libInfo[libNum].size  = (OMX_S64)libStat.st_size;
+        libNum++;
+    }
+
+    if ((bCacheable == OMX_TRUE) &&
+        (Exynos_OMX_Registry_Load(componentList, &totalCompNum, libInfo, libNum) == OMX_ErrorNone)) {
+        Exynos_OSAL_Log(EXYNOS_LOG_INFO, "registry cache hit: %d libraries, %d components", libNum, totalCompNum);
+        goto REGISTERED;
+    }
+
+    rewinddir(dir);
     while ((d = readdir(dir)) != NULL) {
         OMX_HANDLETYPE soHandle;
 
@@ -115,6 +297,8 @@ OMX_ERRORTYPE Exynos_OMX_Component_Register(EXYNOS_OMX_COMPONENT_REGLIST **compL
                 Exynos_OSAL_dlclose(soHandle);
             } else {
                 Exynos_OSAL_Log(EXYNOS_LOG_WARNING, "dlopen failed: %s", Exynos_OSAL_dlerror());
+                /* retry the libraries next time instead of caching a short list */
+                bCacheable = OMX_FALSE;
             }
         } else {
             /* not a component name line. skip */
@@ -122,7 +306,12 @@ OMX_ERRORTYPE Exynos_OMX_Component_Register(EXYNOS_OMX_COMPONENT_REGLIST **compL
         }
     }
 
+    if (bCacheable == OMX_TRUE)
+        Exynos_OMX_Registry_Save(componentList, totalCompNum, libInfo, libNum);
+
+REGISTERED:
     Exynos_OSAL_Free(libName);
+    Exynos_OSAL_Free(libInfo);
 
     closedir(dir);
 
@@ -137,10 +326,29 @@ EXIT:
 
 OMX_ERRORTYPE Exynos_OMX_Component_Unregister(EXYNOS_OMX_COMPONENT_REGLIST *componentList)
 {
-    OMX_ERRORTYPE ret = OMX_ErrorNone;
+    OMX_ERRORTYPE                 ret = OMX_ErrorNone;
+    EXYNOS_OMX_COMPONENT_LIBRARY *library;
 
     Exynos_OSAL_Free(componentList);
 
+    Exynos_OSAL_MutexLock(ghComponentLibraryMutex);
+    while (gComponentLibraryList != NULL) {
+        library = gComponentLibraryList;
+        gComponentLibraryList = library->next;
+
+        if (library->refCount != 0) {
+            /* a component is still alive, its code must stay mapped */
+            Exynos_OSAL_Log(EXYNOS_LOG_WARNING, "%s still in use (%d)", library->libName, library->refCount);
+        } else {
+            Exynos_OSAL_dlclose(library->libHandle);
+        }
+        Exynos_OSAL_Free(library);
+    }
+    Exynos_OSAL_MutexUnlock(ghComponentLibraryMutex);
+
+    Exynos_OSAL_MutexTerminate(ghComponentLibraryMutex);
+    ghComponentLibraryMutex = NULL;
+
 EXIT:
     return ret;
 }
@@ -174,37 +382,92 @@ OMX_ERRORTYPE Exynos_OMX_ComponentAPICheck(OMX_COMPONENTTYPE *component)
     return ret;
 }
 
-OMX_ERRORTYPE Exynos_OMX_ComponentLoad(EXYNOS_OMX_COMPONENT *exynos_component)
+static EXYNOS_OMX_COMPONENT_LIBRARY *Exynos_OMX_ComponentLibrary_Get(OMX_U8 *libName)
 {
-    OMX_ERRORTYPE      ret = OMX_ErrorNone;
-    OMX_HANDLETYPE     libHandle;
-    OMX_COMPONENTTYPE *pOMXComponent;
+    EXYNOS_OMX_COMPONENT_LIBRARY *library = NULL;
+    OMX_HANDLETYPE                libHandle;
 
-    FunctionIn();
+    Exynos_OSAL_MutexLock(ghComponentLibraryMutex);
 
-    OMX_ERRORTYPE (*Exynos_OMX_ComponentInit)(OMX_HANDLETYPE hComponent, OMX_STRING componentName);
+    for (library = gComponentLibraryList; library != NULL; library = library->next) {
+        if (Exynos_OSAL_Strcmp(library->libName, libName) == 0) {
+            library->refCount++;
+            goto EXIT;
+        }
+    }
 
-    libHandle = Exynos_OSAL_dlopen((OMX_STRING)exynos_component->libName, RTLD_NOW);
+    libHandle = Exynos_OSAL_dlopen((OMX_STRING)libName, RTLD_NOW);
     if (!libHandle) {
-        ret = OMX_ErrorInvalidComponentName;
-        Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_ErrorInvalidComponentName, Line:%d", __LINE__);
+        Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "dlopen failed: %s", Exynos_OSAL_dlerror());
         goto EXIT;
     }
 
-    Exynos_OMX_ComponentInit = Exynos_OSAL_dlsym(libHandle, "Exynos_OMX_ComponentInit");
-    if (!Exynos_OMX_ComponentInit) {
+    library = (EXYNOS_OMX_COMPONENT_LIBRARY *)Exynos_OSAL_Malloc(sizeof(EXYNOS_OMX_COMPONENT_LIBRARY));
+    if (library == NULL) {
         Exynos_OSAL_dlclose(libHandle);
-        ret = OMX_ErrorInvalidComponent;
-        Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_ErrorInvalidComponent, Line:%d", __LINE__);
+        goto EXIT;
+    }
+    Exynos_OSAL_Memset(library, 0, sizeof(EXYNOS_OMX_COMPONENT_LIBRARY));
+
+    library->ComponentInit = Exynos_OSAL_dlsym(libHandle, "Exynos_OMX_ComponentInit");
+    if (!library->ComponentInit) {
+        Exynos_OSAL_Free(library);
+        Exynos_OSAL_dlclose(libHandle);
+        library = NULL;
+        goto EXIT;
+    }
+
+    Exynos_OSAL_Strcpy(library->libName, libName);
+    library->libHandle = libHandle;
+    library->refCount = 1;
+    library->next = gComponentLibraryList;
+    gComponentLibraryList = library;
+
+EXIT:
+    Exynos_OSAL_MutexUnlock(ghComponentLibraryMutex);
+
+    return library;
+}
+
+static void Exynos_OMX_ComponentLibrary_Put(OMX_HANDLETYPE libHandle)
+{
+    EXYNOS_OMX_COMPONENT_LIBRARY *library;
+
+    Exynos_OSAL_MutexLock(ghComponentLibraryMutex);
+
+    /* the handle stays open at zero, the next GetHandle skips dlopen */
+    for (library = gComponentLibraryList; library != NULL; library = library->next) {
+        if (library->libHandle == libHandle) {
+            if (library->refCount > 0)
+                library->refCount--;
+            break;
+        }
+    }
+
+    Exynos_OSAL_MutexUnlock(ghComponentLibraryMutex);
+}
+
+OMX_ERRORTYPE Exynos_OMX_ComponentLoad(EXYNOS_OMX_COMPONENT *exynos_component)
+{
+    OMX_ERRORTYPE                 ret = OMX_ErrorNone;
+    EXYNOS_OMX_COMPONENT_LIBRARY *library;
+    OMX_COMPONENTTYPE            *pOMXComponent;
+
+    FunctionIn();
+
+    library = Exynos_OMX_ComponentLibrary_Get(exynos_component->libName);
+    if (library == NULL) {
+        ret = OMX_ErrorInvalidComponentName;
+        Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_ErrorInvalidComponentName, Line:%d", __LINE__);
         goto EXIT;
     }
 
     pOMXComponent = (OMX_COMPONENTTYPE *)Exynos_OSAL_Malloc(sizeof(OMX_COMPONENTTYPE));
     INIT_SET_SIZE_VERSION(pOMXComponent, OMX_COMPONENTTYPE);
-    ret = (*Exynos_OMX_ComponentInit)((OMX_HANDLETYPE)pOMXComponent, (OMX_STRING)exynos_component->componentName);
+    ret = (*library->ComponentInit)((OMX_HANDLETYPE)pOMXComponent, (OMX_STRING)exynos_component->componentName);
     if (ret != OMX_ErrorNone) {
         Exynos_OSAL_Free(pOMXComponent);
-        Exynos_OSAL_dlclose(libHandle);
+        Exynos_OMX_ComponentLibrary_Put(library->libHandle);
         ret = OMX_ErrorInvalidComponent;
         Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_ErrorInvalidComponent, Line:%d", __LINE__);
         goto EXIT;
@@ -213,12 +476,12 @@ OMX_ERRORTYPE Exynos_OMX_ComponentLoad(EXYNOS_OMX_COMPONENT *exynos_component)
             if (NULL != pOMXComponent->ComponentDeInit)
                 pOMXComponent->ComponentDeInit(pOMXComponent);
             Exynos_OSAL_Free(pOMXComponent);
-            Exynos_OSAL_dlclose(libHandle);
+            Exynos_OMX_ComponentLibrary_Put(library->libHandle);
             ret = OMX_ErrorInvalidComponent;
             Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_ErrorInvalidComponent, Line:%d", __LINE__);
             goto EXIT;
         }
-        exynos_component->libHandle = libHandle;
+        exynos_component->libHandle = library->libHandle;
         exynos_component->pOMXComponent = pOMXComponent;
         ret = OMX_ErrorNone;
     }
@@ -249,7 +512,7 @@ OMX_ERRORTYPE Exynos_OMX_ComponentUnload(EXYNOS_OMX_COMPONENT *exynos_component)
     }
 
     if (exynos_component->libHandle != NULL) {
-        Exynos_OSAL_dlclose(exynos_component->libHandle);
+        Exynos_OMX_ComponentLibrary_Put(exynos_component->libHandle);
         exynos_component->libHandle = NULL;
     }
 
@@ -46,6 +46,39 @@ typedef struct _EXYNOS_OMX_COMPONENT_REGLIST
     OMX_U8  libName[MAX_OMX_COMPONENT_LIBNAME_SIZE];
 } EXYNOS_OMX_COMPONENT_REGLIST;
 
+#define EXYNOS_OMX_REGISTRY_MAGIC     0x45584F52 /* "EXOR" */
+#define EXYNOS_OMX_REGISTRY_VERSION   2
+#define EXYNOS_OMX_REGISTRY_FINGERPRINT_SIZE 92 /* PROPERTY_VALUE_MAX */
+
+/* fingerprint of one component library, the cache is valid while all of them match */
+typedef struct _EXYNOS_OMX_REGISTRY_LIBINFO
+{
+    OMX_U8  libName[MAX_OMX_COMPONENT_LIBNAME_SIZE];
+    OMX_S64 mtime;
+    OMX_S64 size;
+} EXYNOS_OMX_REGISTRY_LIBINFO;
+
+typedef struct _EXYNOS_OMX_REGISTRY_HEADER
+{
+    OMX_U32 magic;
+    OMX_U32 version;
+    OMX_U32 recordSize;
+    OMX_U32 libNum;
+    OMX_U32 compNum;
+    /* ro.build.fingerprint, system images may keep library mtime and size across an update */
+    OMX_U8  buildFingerprint[EXYNOS_OMX_REGISTRY_FINGERPRINT_SIZE];
+} EXYNOS_OMX_REGISTRY_HEADER;
+
+/* opened component library, kept warm while the core is initialized */
+typedef struct _EXYNOS_OMX_COMPONENT_LIBRARY
+{
+    OMX_U8                                libName[MAX_OMX_COMPONENT_LIBNAME_SIZE];
+    OMX_HANDLETYPE                        libHandle;
+    OMX_ERRORTYPE                       (*ComponentInit)(OMX_HANDLETYPE hComponent, OMX_STRING componentName);
+    OMX_U32                               refCount;
+    struct _EXYNOS_OMX_COMPONENT_LIBRARY *next;
+} EXYNOS_OMX_COMPONENT_LIBRARY;
+
 struct EXYNOS_OMX_COMPONENT;
 typedef struct _EXYNOS_OMX_COMPONENT
 {
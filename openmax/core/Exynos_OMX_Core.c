@@ -48,8 +48,87 @@ static OMX_U32 gComponentNum = 0;
 
 static EXYNOS_OMX_COMPONENT_REGLIST *gComponentList = NULL;
 static EXYNOS_OMX_COMPONENT *gLoadComponentList = NULL;
+static EXYNOS_OMX_COMPONENT *gLoadComponentListTail = NULL;
 static OMX_HANDLETYPE ghLoadComponentListMutex = NULL;
 
+/* power of two, well above MAX_OMX_COMPONENT_NUM to keep the probe short */
+#define COMPONENT_HASH_SIZE    64
+#define ROLE_HASH_SIZE         64
+#define ROLE_INDEX_NUM         (MAX_OMX_COMPONENT_NUM * MAX_OMX_COMPONENT_ROLE_NUM)
+
+typedef struct _EXYNOS_OMX_ROLE_INDEX
+{
+    OMX_S32 compIndex;
+    OMX_S32 roleIndex;
+    OMX_S32 next;
+} EXYNOS_OMX_ROLE_INDEX;
+
+/* component list index + 1, 0 is an empty slot */
+static OMX_S32 gComponentHash[COMPONENT_HASH_SIZE];
+static OMX_S32 gRoleHashHead[ROLE_HASH_SIZE];
+static OMX_S32 gRoleHashTail[ROLE_HASH_SIZE];
+static EXYNOS_OMX_ROLE_INDEX gRoleIndex[ROLE_INDEX_NUM];
+
+static OMX_U32 Exynos_OMX_StringHash(OMX_U8 *str)
+{
+    OMX_U32 hash = 5381;
+
+    while (*str != '\0')
+        hash = (hash * 33) ^ *str++;
+
+    return hash;
+}
+
+static void Exynos_OMX_BuildComponentIndex(void)
+{
+    OMX_U32 i, j, slot;
+    OMX_S32 roleNum = 0;
+
+    Exynos_OSAL_Memset(gComponentHash, 0, sizeof(gComponentHash));
+    for (i = 0; i < ROLE_HASH_SIZE; i++) {
+        gRoleHashHead[i] = -1;
+        gRoleHashTail[i] = -1;
+    }
+
+    for (i = 0; i < gComponentNum; i++) {
+        slot = Exynos_OMX_StringHash(gComponentList[i].component.componentName) & (COMPONENT_HASH_SIZE - 1);
+        while (gComponentHash[slot] != 0)
+            slot = (slot + 1) & (COMPONENT_HASH_SIZE - 1);
+        gComponentHash[slot] = i + 1;
+
+        /* chains keep registration order, GetComponentsOfRole reports in that order */
+        for (j = 0; j < gComponentList[i].component.totalRoleNum; j++) {
+            if (roleNum == ROLE_INDEX_NUM)
+                break;
+            slot = Exynos_OMX_StringHash(gComponentList[i].component.roles[j]) & (ROLE_HASH_SIZE - 1);
+            gRoleIndex[roleNum].compIndex = i;
+            gRoleIndex[roleNum].roleIndex = j;
+            gRoleIndex[roleNum].next = -1;
+            if (gRoleHashTail[slot] == -1)
+                gRoleHashHead[slot] = roleNum;
+            else
+                gRoleIndex[gRoleHashTail[slot]].next = roleNum;
+            gRoleHashTail[slot] = roleNum;
+            roleNum++;
+        }
+    }
+}
+
+static OMX_S32 Exynos_OMX_FindComponent(OMX_STRING cComponentName)
+{
+    OMX_U32 slot;
+    OMX_S32 index;
+
+    slot = Exynos_OMX_StringHash((OMX_U8 *)cComponentName) & (COMPONENT_HASH_SIZE - 1);
+    while ((index = gComponentHash[slot]) != 0) {
+        if (Exynos_OSAL_Strcmp(cComponentName, gComponentList[index - 1].component.componentName) == 0)
+            return index - 1;
+        slot = (slot + 1) & (COMPONENT_HASH_SIZE - 1);
+    }
+
+    return -1;
+}
+
 
 OMX_API OMX_ERRORTYPE OMX_APIENTRY Exynos_OMX_Init(void)
 {
@@ -64,6 +143,8 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY Exynos_OMX_Init(void)
             goto EXIT;
         }
 
+        Exynos_OMX_BuildComponentIndex();
+
         ret = Exynos_OMX_ResourceManager_Init();
         if (OMX_ErrorNone != ret) {
             Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "Exynos_OMX_Init : Exynos_OMX_ResourceManager_Init failed");
@@ -142,8 +223,7 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY Exynos_OMX_GetHandle(
 {
     OMX_ERRORTYPE         ret = OMX_ErrorNone;
     EXYNOS_OMX_COMPONENT *loadComponent;
-    EXYNOS_OMX_COMPONENT *currentComponent;
-    unsigned int i = 0;
+    OMX_S32               i = 0;
 
     FunctionIn();
 
@@ -158,48 +238,43 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY Exynos_OMX_GetHandle(
     }
     Exynos_OSAL_Log(EXYNOS_LOG_TRACE, "ComponentName : %s", cComponentName);
 
-    for (i = 0; i < gComponentNum; i++) {
-        if (Exynos_OSAL_Strcmp(cComponentName, gComponentList[i].component.componentName) == 0) {
-            loadComponent = Exynos_OSAL_Malloc(sizeof(EXYNOS_OMX_COMPONENT));
-            Exynos_OSAL_Memset(loadComponent, 0, sizeof(EXYNOS_OMX_COMPONENT));
-
-            Exynos_OSAL_Strcpy(loadComponent->libName, gComponentList[i].libName);
-            Exynos_OSAL_Strcpy(loadComponent->componentName, gComponentList[i].component.componentName);
-            ret = Exynos_OMX_ComponentLoad(loadComponent);
-            if (ret != OMX_ErrorNone) {
-                Exynos_OSAL_Free(loadComponent);
-                Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_Error, Line:%d", __LINE__);
-                goto EXIT;
-            }
+    i = Exynos_OMX_FindComponent(cComponentName);
+    if (i < 0) {
+        ret = OMX_ErrorComponentNotFound;
+        goto EXIT;
+    }
 
-            ret = loadComponent->pOMXComponent->SetCallbacks(loadComponent->pOMXComponent, pCallBacks, pAppData);
-            if (ret != OMX_ErrorNone) {
-                Exynos_OMX_ComponentUnload(loadComponent);
-                Exynos_OSAL_Free(loadComponent);
-                Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_Error, Line:%d", __LINE__);
-                goto EXIT;
-            }
+    loadComponent = Exynos_OSAL_Malloc(sizeof(EXYNOS_OMX_COMPONENT));
+    Exynos_OSAL_Memset(loadComponent, 0, sizeof(EXYNOS_OMX_COMPONENT));
 
-            Exynos_OSAL_MutexLock(ghLoadComponentListMutex);
-            if (gLoadComponentList == NULL) {
-                gLoadComponentList = loadComponent;
-            } else {
-                currentComponent = gLoadComponentList;
-                while (currentComponent->nextOMXComp != NULL) {
-                    currentComponent = currentComponent->nextOMXComp;
-                }
-                currentComponent->nextOMXComp = loadComponent;
-            }
-            Exynos_OSAL_MutexUnlock(ghLoadComponentListMutex);
+    Exynos_OSAL_Strcpy(loadComponent->libName, gComponentList[i].libName);
+    Exynos_OSAL_Strcpy(loadComponent->componentName, gComponentList[i].component.componentName);
+    ret = Exynos_OMX_ComponentLoad(loadComponent);
+    if (ret != OMX_ErrorNone) {
+        Exynos_OSAL_Free(loadComponent);
+        Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_Error, Line:%d", __LINE__);
+        goto EXIT;
+    }
 
-            *pHandle = loadComponent->pOMXComponent;
-            ret = OMX_ErrorNone;
-            Exynos_OSAL_Log(EXYNOS_LOG_TRACE, "Exynos_OMX_GetHandle : %s", "OMX_ErrorNone");
-            goto EXIT;
-        }
+    ret = loadComponent->pOMXComponent->SetCallbacks(loadComponent->pOMXComponent, pCallBacks, pAppData);
+    if (ret != OMX_ErrorNone) {
+        Exynos_OMX_ComponentUnload(loadComponent);
+        Exynos_OSAL_Free(loadComponent);
+        Exynos_OSAL_Log(EXYNOS_LOG_ERROR, "OMX_Error, Line:%d", __LINE__);
+        goto EXIT;
     }
 
-    ret = OMX_ErrorComponentNotFound;
+    Exynos_OSAL_MutexLock(ghLoadComponentListMutex);
+    if (gLoadComponentList == NULL)
+        gLoadComponentList = loadComponent;
+    else
+        gLoadComponentListTail->nextOMXComp = loadComponent;
+    gLoadComponentListTail = loadComponent;
+    Exynos_OSAL_MutexUnlock(ghLoadComponentListMutex);
+
+    *pHandle = loadComponent->pOMXComponent;
+    ret = OMX_ErrorNone;
+    Exynos_OSAL_Log(EXYNOS_LOG_TRACE, "Exynos_OMX_GetHandle : %s", "OMX_ErrorNone");
 
 EXIT:
     FunctionOut();
@@ -230,6 +305,8 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY Exynos_OMX_FreeHandle(OMX_IN OMX_HANDLETYPE h
     if (gLoadComponentList->pOMXComponent == hComponent) {
         deleteComponent = gLoadComponentList;
         gLoadComponentList = gLoadComponentList->nextOMXComp;
+        if (gLoadComponentList == NULL)
+            gLoadComponentListTail = NULL;
     } else {
         currentComponent = gLoadComponentList;
 
@@ -238,6 +315,8 @@ OMX_API OMX_ERRORTYPE OMX_APIENTRY Exynos_OMX_FreeHandle(OMX_IN OMX_HANDLETYPE h
             if (currentComponent->nextOMXComp->pOMXComponent == hComponent) {
                 deleteComponent = currentComponent->nextOMXComp;
                 currentComponent->nextOMXComp = deleteComponent->nextOMXComp;
+                if (gLoadComponentListTail == deleteComponent)
+                    gLoadComponentListTail = currentComponent;
                 break;
             }
             currentComponent = currentComponent->nextOMXComp;
@@ -288,8 +367,6 @@ OMX_API OMX_ERRORTYPE Exynos_OMX_GetComponentsOfRole (
     OMX_INOUT OMX_U8  **compNames)
 {
     OMX_ERRORTYPE ret = OMX_ErrorNone;
-    int           max_role_num = 0;
-    OMX_STRING    RoleString[MAX_OMX_COMPONENT_ROLE_SIZE];
     int i = 0, j = 0;
 
     FunctionIn();
@@ -301,16 +378,13 @@ OMX_API OMX_ERRORTYPE Exynos_OMX_GetComponentsOfRole (
 
     *pNumComps = 0;
 
-    for (i = 0; i < MAX_OMX_COMPONENT_NUM; i++) {
-        max_role_num = gComponentList[i].component.totalRoleNum;
-
-        for (j = 0; j < max_role_num; j++) {
-            if (Exynos_OSAL_Strcmp(gComponentList[i].component.roles[j], role) == 0) {
-                if (compNames != NULL) {
-                    Exynos_OSAL_Strcpy((OMX_STRING)compNames[*pNumComps], gComponentList[i].component.componentName);
-                }
-                *pNumComps = (*pNumComps + 1);
+    for (i = gRoleHashHead[Exynos_OMX_StringHash((OMX_U8 *)role) & (ROLE_HASH_SIZE - 1)]; i != -1; i = gRoleIndex[i].next) {
+        j = gRoleIndex[i].compIndex;
+        if (Exynos_OSAL_Strcmp(gComponentList[j].component.roles[gRoleIndex[i].roleIndex], role) == 0) {
+            if (compNames != NULL) {
+                Exynos_OSAL_Strcpy((OMX_STRING)compNames[*pNumComps], gComponentList[j].component.componentName);
             }
+            *pNumComps = (*pNumComps + 1);
         }
     }
 
@@ -337,18 +411,16 @@ OMX_API OMX_ERRORTYPE Exynos_OMX_GetRolesOfComponent (
         goto EXIT;
     }
 
-    for (i = 0; i < MAX_OMX_COMPONENT_NUM; i++) {
-        if (gComponentList != NULL) {
-            if (Exynos_OSAL_Strcmp(gComponentList[i].component.componentName, compName) == 0) {
-                *pNumRoles = totalRoleNum = gComponentList[i].component.totalRoleNum;
-                compNum = i;
-                detectComp = OMX_TRUE;
-                break;
-            }
-        } else {
-            ret = OMX_ErrorUndefined;
-            goto EXIT;
-        }
+    if (gComponentList == NULL) {
+        ret = OMX_ErrorUndefined;
+        goto EXIT;
+    }
+
+    i = Exynos_OMX_FindComponent(compName);
+    if (i >= 0) {
+        *pNumRoles = totalRoleNum = gComponentList[i].component.totalRoleNum;
+        compNum = i;
+        detectComp = OMX_TRUE;
     }
 
     if (detectComp == OMX_FALSE) {
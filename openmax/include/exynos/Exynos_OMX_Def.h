@@ -51,6 +51,7 @@
 #define INDEX_AFTER_EOS      0xE05
 
 #define EXYNOS_OMX_INSTALL_PATH "/system/lib/omx/"
+#define EXYNOS_OMX_REGISTRY_CACHE_PATH "/data/misc/media/exynos_omx_registry.cache"
 
 typedef enum _EXYNOS_CODEC_TYPE
 {